@@ -0,0 +1,47 @@
+#include "arena.h"
+#include<stdlib.h>
+
+#define CHUNK_SIZE (64 * 1024)
+// the strictest alignment of the objects in the compiler
+#define ALIGNMENT sizeof(union { void* p; double d; long l; })
+
+_Thread_local Arena* currentArena = NULL;
+_Thread_local size_t arenaAllocCount = 0;
+_Thread_local size_t arenaAllocBytes = 0;
+
+void* arenaAlloc(Arena* arena, size_t size) {
+    size = (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    arenaAllocCount++;
+    arenaAllocBytes += size;
+    ArenaChunk* c = arena->head;
+    if (c != NULL && size > CHUNK_SIZE) {
+        // big objects get a chunk of their own, which is linked behind the head
+        // so the space left in the head chunk is still in use
+        c = (ArenaChunk*)malloc(sizeof(ArenaChunk) + size);
+        c->size = c->used = size;
+        c->next = arena->head->next;
+        arena->head->next = c;
+        return c->data;
+    }
+    if (c == NULL || c->size - c->used < size) {
+        size_t chunkSize = size > CHUNK_SIZE ? size : CHUNK_SIZE;
+        c = (ArenaChunk*)malloc(sizeof(ArenaChunk) + chunkSize);
+        c->size = chunkSize;
+        c->used = 0;
+        c->next = arena->head;
+        arena->head = c;
+    }
+    void* res = c->data + c->used;
+    c->used += size;
+    return res;
+}
+
+void arenaFree(Arena* arena) {
+    ArenaChunk* c = arena->head;
+    while (c != NULL) {
+        ArenaChunk* next = c->next;
+        free(c);
+        c = next;
+    }
+    arena->head = NULL;
+}
@@ -0,0 +1,35 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/*
+ * a region allocator
+ * objects are bumped out of big chunks and never freed one by one,
+ * all of them are released at once when the arena is freed
+ */
+typedef struct ArenaChunk {
+    struct ArenaChunk* next;
+    size_t size;    // capacity of `data`
+    size_t used;
+    char data[];
+} ArenaChunk;
+
+typedef struct Arena {
+    ArenaChunk* head;   // the chunk being allocated from, followed by the full ones
+} Arena;
+
+#define ARENA_INIT { NULL }
+
+// the arena that `NEW` allocates from
+// it is switched by the driver when a new compilation phase begins,
+// and each thread has its own, so the threads can compile different sources
+extern _Thread_local Arena* currentArena;
+// running totals of the allocations of the thread, sampled by the time report
+extern _Thread_local size_t arenaAllocCount;
+extern _Thread_local size_t arenaAllocBytes;
+
+void* arenaAlloc(Arena* arena, size_t size);
+void arenaFree(Arena* arena);
+
+#endif
@@ -0,0 +1,30 @@
+#include "asmwriter.h"
+
+void initAsmWriter(AsmWriter* w, FILE* out, FILE* tee) {
+    w->out = out;
+    w->tee = tee;
+    w->failed = false;
+    w->len = 0;
+}
+
+static void writeOut(AsmWriter* w, const char* s, size_t n) {
+    if (fwrite(s, 1, n, w->out) != n) { w->failed = true; }
+    if (w->tee != NULL && fwrite(s, 1, n, w->tee) != n) { w->failed = true; }
+}
+
+void flushAsmWriter(AsmWriter* w) {
+    if (w->len != 0) {
+        writeOut(w, w->data, w->len);
+        w->len = 0;
+    }
+}
+
+void emitLongStr(AsmWriter* w, const char* s, size_t n) {
+    flushAsmWriter(w);
+    if (n >= ASM_BUFFER_SIZE) {
+        writeOut(w, s, n);
+        return;
+    }
+    memcpy(w->data, s, n);
+    w->len = n;
+}
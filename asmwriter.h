@@ -0,0 +1,73 @@
+#ifndef ASMWRITER_H
+#define ASMWRITER_H
+
+#include<stdbool.h>
+#include<stdio.h>
+#include<string.h>
+
+/*
+ * the buffered writer of the assembly
+ * the text is formatted by hand into a big buffer, which is written out with a single
+ * call whenever it is full, so no format string is parsed for any instruction
+ * the text can go to a second file as well, such as a new cache entry
+ */
+#define ASM_BUFFER_SIZE (64 * 1024)
+// the longest piece appended at once without a check, an int takes at most 11 chars
+#define ASM_MAX_PIECE 16
+
+typedef struct AsmWriter {
+    FILE* out;
+    FILE* tee;      // the second file, NULL for none
+    bool failed;    // whether any write fell short
+    size_t len;
+    char data[ASM_BUFFER_SIZE];
+} AsmWriter;
+
+void initAsmWriter(AsmWriter* w, FILE* out, FILE* tee);
+// write out everything in the buffer
+void flushAsmWriter(AsmWriter* w);
+// the slow path for strings longer than the room left
+void emitLongStr(AsmWriter* w, const char* s, size_t n);
+
+static inline void emitChar(AsmWriter* w, char c) {
+    if (w->len == ASM_BUFFER_SIZE) { flushAsmWriter(w); }
+    w->data[w->len++] = c;
+}
+
+static inline void emitStr(AsmWriter* w, const char* s) {
+    size_t n = strlen(s);
+    if (ASM_BUFFER_SIZE - w->len < n) {
+        emitLongStr(w, s, n);
+        return;
+    }
+    memcpy(w->data + w->len, s, n);
+    w->len += n;
+}
+
+static inline void emitInt(AsmWriter* w, int x) {
+    char digits[ASM_MAX_PIECE];
+    int n = 0;
+    // through unsigned, so that the negation of INT_MIN does not overflow
+    unsigned u = x < 0 ? 0u - (unsigned)x : (unsigned)x;
+    do {
+        digits[n++] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u != 0);
+    if (ASM_BUFFER_SIZE - w->len < ASM_MAX_PIECE) { flushAsmWriter(w); }
+    if (x < 0) { w->data[w->len++] = '-'; }
+    while (n > 0) { w->data[w->len++] = digits[--n]; }
+}
+
+// in upper case hex, without a prefix
+static inline void emitHex(AsmWriter* w, unsigned x) {
+    char digits[ASM_MAX_PIECE];
+    int n = 0;
+    do {
+        digits[n++] = "0123456789ABCDEF"[x % 16];
+        x /= 16;
+    } while (x != 0);
+    if (ASM_BUFFER_SIZE - w->len < ASM_MAX_PIECE) { flushAsmWriter(w); }
+    while (n > 0) { w->data[w->len++] = digits[--n]; }
+}
+
+#endif
@@ -0,0 +1,104 @@
+#include "atom.h"
+#include "arena.h"
+#include "common.h"
+#include<assert.h>
+#include<pthread.h>
+#include<stdlib.h>
+#include<string.h>
+
+#define INIT_TABLE_SIZE 1024    // must be a power of 2
+
+typedef struct AtomEntry {
+    unsigned hash;
+    int length;
+    Atom name;      // NULL for an empty slot
+} AtomEntry;
+
+// an open addressing hash table, the spellings are stored in `pool`
+static AtomEntry* table = NULL;
+static unsigned tableSize = 0;
+static unsigned atomNum = 0;
+static Arena pool = ARENA_INIT;
+static pthread_mutex_t tableLock = PTHREAD_MUTEX_INITIALIZER;
+
+Atom atomMain, atomRead, atomWrite;
+
+// FNV-1a
+static unsigned hashSlice(const char* s, int length) {
+    unsigned h = 2166136261u;
+    int i;
+    for (i = 0; i < length; i++) {
+        h = (h ^ (unsigned char)s[i]) * 16777619u;
+    }
+    return h;
+}
+
+// copy the spelling into the pool, with a terminating NUL
+static Atom storeSlice(const char* s, int length) {
+    char* res = (char*)arenaAlloc(&pool, length + 1);
+    memcpy(res, s, length);
+    res[length] = '\0';
+    return res;
+}
+
+static void growTable() {
+    AtomEntry* old = table;
+    unsigned oldSize = tableSize;
+    tableSize = oldSize == 0 ? INIT_TABLE_SIZE : oldSize * 2;
+    table = (AtomEntry*)calloc(tableSize, sizeof(AtomEntry));
+    unsigned i;
+    for (i = 0; i < oldSize; i++) {
+        if (old[i].name == NULL) { continue; }
+        unsigned j = old[i].hash & (tableSize - 1);
+        while (table[j].name != NULL) {
+            j = (j + 1) & (tableSize - 1);
+        }
+        table[j] = old[i];
+    }
+    free(old);
+}
+
+Atom internSlice(const char* s, int length) {
+    unsigned h = hashSlice(s, length);
+    pthread_mutex_lock(&tableLock);
+    // keep the load factor under 1/2
+    if (2 * (atomNum + 1) > tableSize) {
+        growTable();
+    }
+    unsigned i = h & (tableSize - 1);
+    for (; table[i].name != NULL; i = (i + 1) & (tableSize - 1)) {
+        if (table[i].hash == h && table[i].length == length
+            && memcmp(table[i].name, s, length) == 0) {
+            break;
+        }
+    }
+    if (table[i].name == NULL) {
+        table[i].hash = h;
+        table[i].length = length;
+        table[i].name = storeSlice(s, length);
+        atomNum++;
+    }
+    Atom res = table[i].name;
+    pthread_mutex_unlock(&tableLock);
+    return res;
+}
+
+Atom intern(const char* s) {
+    return internSlice(s, strlen(s));
+}
+
+// the names that the compiler refers to by itself
+void initAtoms() {
+    atomMain = intern("main");
+    atomRead = intern("read");
+    atomWrite = intern("write");
+}
+
+// release all the atoms, they are dangling pointers after this call
+void freeAtoms() {
+    arenaFree(&pool);
+    free(table);
+    table = NULL;
+    tableSize = 0;
+    atomNum = 0;
+}
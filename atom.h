@@ -0,0 +1,19 @@
+#ifndef ATOM_H
+#define ATOM_H
+
+/*
+ * interned identifiers
+ * each distinct spelling is stored only once, thus two atoms are
+ * the same name if and only if they are the same pointer
+ * the table is shared by all the threads, and interning takes its lock
+ */
+typedef const char* Atom;
+
+extern Atom atomMain, atomRead, atomWrite;
+
+void initAtoms();
+void freeAtoms();
+Atom internSlice(const char* s, int length);
+Atom intern(const char* s);
+
+#endif
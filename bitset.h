@@ -0,0 +1,66 @@
+#ifndef BITSET_H
+#define BITSET_H
+
+#include "common.h"
+#include<stdlib.h>
+#include<string.h>
+
+/*
+ * dense sets of small integers, such as the vregs of a function
+ * a set is a plain array of words, the number of the words is kept by the user
+ */
+typedef unsigned long long Word;
+#define WORD_BITS 64
+#define BITSET_WORDS(bits) (((bits) + WORD_BITS - 1) / WORD_BITS)
+
+// an empty set on the heap
+static inline Word* newBitset(int words) {
+    return (Word*)calloc(words + 1, sizeof(Word));
+}
+
+static inline bool bitTest(const Word* s, int i) {
+    return (s[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+}
+
+static inline void bitSet(Word* s, int i) {
+    s[i / WORD_BITS] |= (Word)1 << (i % WORD_BITS);
+}
+
+static inline void bitClear(Word* s, int i) {
+    s[i / WORD_BITS] &= ~((Word)1 << (i % WORD_BITS));
+}
+
+static inline void bitsetClear(Word* s, int words) {
+    memset(s, 0, words * sizeof(Word));
+}
+
+// all of [0, bits)
+static inline void bitsetFill(Word* s, int words, int bits) {
+    memset(s, 0xff, words * sizeof(Word));
+    if (bits % WORD_BITS != 0) { s[words - 1] = ((Word)1 << (bits % WORD_BITS)) - 1; }
+}
+
+static inline void bitsetCopy(Word* to, const Word* from, int words) {
+    memcpy(to, from, words * sizeof(Word));
+}
+
+static inline bool bitsetEqual(const Word* a, const Word* b, int words) {
+    return memcmp(a, b, words * sizeof(Word)) == 0;
+}
+
+static inline void bitsetUnion(Word* to, const Word* from, int words) {
+    int i;
+    for (i = 0; i < words; i++) { to[i] |= from[i]; }
+}
+
+static inline void bitsetIntersect(Word* to, const Word* from, int words) {
+    int i;
+    for (i = 0; i < words; i++) { to[i] &= from[i]; }
+}
+
+static inline void bitsetDiff(Word* to, const Word* from, int words) {
+    int i;
+    for (i = 0; i < words; i++) { to[i] &= ~from[i]; }
+}
+
+#endif
@@ -0,0 +1,102 @@
+#define _DEFAULT_SOURCE
+#include "cache.h"
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<sys/stat.h>
+#include<unistd.h>
+
+// two 64-bit FNV-1a hashes with different offset bases, 128 bits together
+typedef struct Hash {
+    unsigned long long h[2];
+} Hash;
+
+static void hashBytes(Hash* hash, const char* bytes, size_t size) {
+    const unsigned long long prime = 0x100000001b3ULL;
+    size_t i;
+    for (i = 0; i < size; i++) {
+        unsigned char c = (unsigned char)bytes[i];
+        hash->h[0] = (hash->h[0] ^ c) * prime;
+        hash->h[1] = (hash->h[1] ^ c) * prime;
+    }
+}
+
+// the strings are hashed with their terminators, so the fields can not run into each other
+static void hashString(Hash* hash, const char* s) {
+    hashBytes(hash, s, strlen(s) + 1);
+}
+
+// the hash of the compiler binary, so a rebuilt compiler never reads the entries of an old one
+static Hash binaryHash;
+
+bool initCache() {
+    Hash hash = { { 0xcbf29ce484222325ULL, 0x6c62272e07bb0142ULL } };
+    FILE* exe = fopen("/proc/self/exe", "rb");
+    if (exe == NULL) { return false; }
+    char buf[8192];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), exe)) > 0) { hashBytes(&hash, buf, n); }
+    bool ok = !ferror(exe);
+    fclose(exe);
+    binaryHash = hash;
+    return ok;
+}
+
+CacheKey cacheKey(const SourceFile* src, const char* flags) {
+    Hash hash = binaryHash;
+    hashString(&hash, flags);
+    hashBytes(&hash, src->text, src->size);
+    CacheKey key;
+    snprintf(key.hex, sizeof(key.hex), "%016llx%016llx", hash.h[0], hash.h[1]);
+    return key;
+}
+
+static void entryPath(char* path, size_t size, const char* dir, const CacheKey* key) {
+    snprintf(path, size, "%s/%s.s", dir, key->hex);
+}
+
+static bool copyFile(FILE* from, FILE* to) {
+    char buf[8192];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), from)) > 0) {
+        if (fwrite(buf, 1, n, to) != n) { return false; }
+    }
+    return !ferror(from);
+}
+
+bool cacheFetch(const char* dir, const CacheKey* key, const char* outPath) {
+    char path[4096];
+    entryPath(path, sizeof(path), dir, key);
+    // an entry is renamed into place only when it is complete
+    FILE* entry = fopen(path, "rb");
+    if (entry == NULL) { return false; }
+    FILE* out = fopen(outPath, "wb");
+    bool ok = out != NULL && copyFile(entry, out);
+    if (out != NULL && fclose(out) != 0) { ok = false; }
+    fclose(entry);
+    return ok;
+}
+
+void cacheBeginStore(const char* dir, const CacheKey* key, CacheEntry* entry) {
+    entryPath(entry->path, sizeof(entry->path), dir, key);
+    snprintf(entry->tmpPath, sizeof(entry->tmpPath), "%s.XXXXXX", entry->path);
+    entry->file = NULL;
+    int fd = mkstemp(entry->tmpPath);
+    if (fd < 0) { return; }     // the cache is best effort, the output is written anyway
+    fchmod(fd, 0644);           // the entries are shared with other builds
+    entry->file = fdopen(fd, "wb");
+    if (entry->file == NULL) {
+        close(fd);
+        unlink(entry->tmpPath);
+    }
+}
+
+void cacheEndStore(CacheEntry* entry, bool ok) {
+    if (entry->file == NULL) { return; }
+    if (fclose(entry->file) != 0) { ok = false; }
+    entry->file = NULL;
+    // the rename is atomic, a concurrent writer of the same entry writes the same bytes
+    if (!ok || rename(entry->tmpPath, entry->path) != 0) {
+        unlink(entry->tmpPath);
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "common.h"
+#include "source.h"
+#include<stdio.h>
+
+/*
+ * the on-disk compilation cache (`--cache=DIR`)
+ * an entry holds the assembly of a program, and is named after the hash of
+ * the source bytes, the compiler binary and the flags affecting the output
+ * entries are written to a temporary file and renamed into place,
+ * so a reader sees either a whole entry or none, and parallel builds can share a directory
+ */
+typedef struct CacheKey {
+    char hex[33];   // 128 bits in hex
+} CacheKey;
+
+// an entry being written, under its temporary name
+typedef struct CacheEntry {
+    char path[4096], tmpPath[4096];
+    FILE* file;     // NULL when the entry could not be created
+} CacheEntry;
+
+// hash the running binary, once before any key is made, false when it can not be read
+bool initCache();
+CacheKey cacheKey(const SourceFile* src, const char* flags);
+// copy the cached assembly to `outPath`, false on a miss
+bool cacheFetch(const char* dir, const CacheKey* key, const char* outPath);
+// create a new entry, the assembly is written to its file along with the output
+void cacheBeginStore(const char* dir, const CacheKey* key, CacheEntry* entry);
+// rename the entry into place when `ok`, that is every write of the assembly succeeded, or drop it
+void cacheEndStore(CacheEntry* entry, bool ok);
+
+#endif
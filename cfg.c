@@ -0,0 +1,294 @@
+#include "cfg.h"
+#include<assert.h>
+#include<stdlib.h>
+#include<string.h>
+
+// the label oprand of a jump, NULL for the other instructions
+static const Oprand* jumpLabel(const Instruction* i) {
+    if (i->tag == I_GOTO) { return &i->addrs[0]; }
+    if (isCondGoto(i->tag)) { return &i->addrs[2]; }
+    return NULL;
+}
+
+static const Instruction* lastInst(const BasicBlock* b) {
+    return b->instNum == 0 ? NULL : &b->insts[b->instNum - 1];
+}
+
+// the blocks ending with an unconditional transfer never fall through
+static bool endsFlow(const Instruction* i) {
+    return i != NULL && (i->tag == I_GOTO || i->tag == I_RET);
+}
+
+int addBlock(CFG* cfg) {
+    cfg->blocks = (BasicBlock*)reserveSlot(cfg->blocks, cfg->blockNum, &cfg->blockCap, sizeof(BasicBlock));
+    BasicBlock* b = &cfg->blocks[cfg->blockNum];
+    b->insts = NULL;
+    b->instNum = b->instCap = 0;
+    b->fall = -1;
+    b->succNum = 0;
+    b->preds = NULL;
+    b->predNum = b->predCap = 0;
+    b->rpo = -1;
+    return cfg->blockNum++;
+}
+
+void appendInst(BasicBlock* b, Instruction inst) {
+    b->insts = (Instruction*)reserveSlot(b->insts, b->instNum, &b->instCap, sizeof(Instruction));
+    b->insts[b->instNum++] = inst;
+}
+
+void insertInst(BasicBlock* b, int pos, Instruction inst) {
+    assert(pos >= 0 && pos <= b->instNum);
+    b->insts = (Instruction*)reserveSlot(b->insts, b->instNum, &b->instCap, sizeof(Instruction));
+    memmove(&b->insts[pos + 1], &b->insts[pos], (b->instNum - pos) * sizeof(Instruction));
+    b->insts[pos] = inst;
+    b->instNum++;
+}
+
+void removeInst(BasicBlock* b, int pos) {
+    assert(pos >= 0 && pos < b->instNum);
+    memmove(&b->insts[pos], &b->insts[pos + 1], (b->instNum - pos - 1) * sizeof(Instruction));
+    b->instNum--;
+}
+
+int splitEdge(CFG* cfg, int from, int to) {
+    Oprand target = blockLabel(cfg, to);
+    int mid = addBlock(cfg), k, j;
+    Oprand midLabel = makeLabelOp(newFuncLabel(cfg->func));
+    appendInst(&cfg->blocks[mid], makeUnaryInst(I_LABEL, midLabel));
+    appendInst(&cfg->blocks[mid], makeUnaryInst(I_GOTO, target));
+    BasicBlock* fromBlock = &cfg->blocks[from];
+    if (fromBlock->fall == to) { fromBlock->fall = mid; }
+    Instruction* last = fromBlock->instNum == 0 ? NULL : &fromBlock->insts[fromBlock->instNum - 1];
+    if (last != NULL && jumpLabel(last) != NULL && jumpLabel(last)->content.label == target.content.label) {
+        last->addrs[last->tag == I_GOTO ? 0 : 2] = midLabel;
+    }
+    BasicBlock* toBlock = &cfg->blocks[to];
+    // after its label, which `blockLabel` made sure of
+    for (k = 1; k < toBlock->instNum && toBlock->insts[k].tag == I_PHI; k++) {
+        PhiArg* args = toBlock->insts[k].addrs[1].content.args;
+        for (j = 0; j < toBlock->insts[k].addrs[2].content.lit; j++) {
+            if (args[j].pred == from) { args[j].pred = mid; }
+        }
+    }
+    return mid;
+}
+
+int jumpTarget(const CFG* cfg, const Instruction* i) {
+    const Oprand* label = jumpLabel(i);
+    assert(label != NULL && label->content.label < cfg->func->labelNum);
+    int res = cfg->labelBlock[label->content.label];
+    assert(res >= 0);
+    return res;
+}
+
+CFG* buildCFG(IRFunction* func) {
+    NEW(CFG, cfg);
+    cfg->func = func;
+    cfg->blocks = NULL;
+    cfg->blockNum = cfg->blockCap = 0;
+    cfg->labelBlock = NULL;
+    cfg->order = NULL;
+    cfg->orderNum = 0;
+
+    int cur = addBlock(cfg);
+    bool closed = false;    // the current block ends with a jump
+    int k;
+    for (k = 0; k < func->instNum; k++) {
+        const Instruction* i = &func->insts[k];
+        // a label starts a block, and a jump ends one
+        if (closed || (i->tag == I_LABEL && cfg->blocks[cur].instNum != 0)) {
+            int next = addBlock(cfg);
+            if (!endsFlow(lastInst(&cfg->blocks[cur]))) { cfg->blocks[cur].fall = next; }
+            cur = next;
+            closed = false;
+        }
+        appendInst(&cfg->blocks[cur], *i);
+        closed = jumpLabel(i) != NULL || i->tag == I_RET;
+    }
+    // a conditional jump at the very end still has a way to fall through
+    if (closed && isCondGoto(lastInst(&cfg->blocks[cur])->tag)) {
+        int next = addBlock(cfg);
+        cfg->blocks[cur].fall = next;
+    }
+    connectBlocks(cfg);
+    return cfg;
+}
+
+static void addEdge(CFG* cfg, int from, int to) {
+    BasicBlock* b = &cfg->blocks[from];
+    // both ways of a conditional jump may reach the same block, which is a single edge
+    if (b->succNum == 1 && b->succs[0] == to) { return; }
+    assert(b->succNum < 2);
+    b->succs[b->succNum++] = to;
+    BasicBlock* t = &cfg->blocks[to];
+    t->preds = (int*)reserveSlot(t->preds, t->predNum, &t->predCap, sizeof(int));
+    t->preds[t->predNum++] = from;
+}
+
+// the reverse postorder of a depth first search from the entry, with an explicit stack
+static void computeOrder(CFG* cfg) {
+    int n = cfg->blockNum;
+    int* stack = (int*)malloc(n * sizeof(int));
+    int* nextSucc = (int*)calloc(n, sizeof(int));
+    bool* visited = (bool*)calloc(n, sizeof(bool));
+    int* post = (int*)malloc(n * sizeof(int));
+    int top = 0, postNum = 0, k;
+
+    stack[top++] = 0;
+    visited[0] = true;
+    while (top > 0) {
+        int b = stack[top - 1];
+        const BasicBlock* block = &cfg->blocks[b];
+        if (nextSucc[b] < block->succNum) {
+            int s = block->succs[nextSucc[b]++];
+            if (!visited[s]) {
+                visited[s] = true;
+                stack[top++] = s;
+            }
+        }
+        else {
+            post[postNum++] = b;
+            top--;
+        }
+    }
+
+    cfg->order = (int*)arenaAlloc(currentArena, (postNum + 1) * sizeof(int));
+    cfg->orderNum = postNum;
+    for (k = 0; k < n; k++) { cfg->blocks[k].rpo = -1; }
+    for (k = 0; k < postNum; k++) {
+        int b = post[postNum - 1 - k];
+        cfg->order[k] = b;
+        cfg->blocks[b].rpo = k;
+    }
+    free(stack);
+    free(nextSucc);
+    free(visited);
+    free(post);
+}
+
+void connectBlocks(CFG* cfg) {
+    int b, l;
+    cfg->labelBlock = (int*)arenaAlloc(currentArena, (cfg->func->labelNum + 1) * sizeof(int));
+    for (l = 0; l < cfg->func->labelNum; l++) { cfg->labelBlock[l] = -1; }
+    for (b = 0; b < cfg->blockNum; b++) {
+        BasicBlock* block = &cfg->blocks[b];
+        block->succNum = block->predNum = 0;
+        if (block->instNum != 0 && block->insts[0].tag == I_LABEL) {
+            cfg->labelBlock[block->insts[0].addrs[0].content.label] = b;
+        }
+    }
+    for (b = 0; b < cfg->blockNum; b++) {
+        const Instruction* last = lastInst(&cfg->blocks[b]);
+        if (endsFlow(last)) { cfg->blocks[b].fall = -1; }
+        if (cfg->blocks[b].fall >= 0) { addEdge(cfg, b, cfg->blocks[b].fall); }
+        if (last != NULL && jumpLabel(last) != NULL) { addEdge(cfg, b, jumpTarget(cfg, last)); }
+    }
+    computeOrder(cfg);
+}
+
+// a block doing nothing but jumping elsewhere
+static bool isForwarder(const BasicBlock* b) {
+    if (b->instNum == 1) { return b->insts[0].tag == I_GOTO; }
+    return b->instNum == 2 && b->insts[0].tag == I_LABEL && b->insts[1].tag == I_GOTO;
+}
+
+// make sure a block starts with a label, so that it can be jumped to
+Oprand blockLabel(CFG* cfg, int b) {
+    BasicBlock* block = &cfg->blocks[b];
+    if (block->instNum == 0 || block->insts[0].tag != I_LABEL) {
+        insertInst(block, 0, makeUnaryInst(I_LABEL, makeLabelOp(newFuncLabel(cfg->func))));
+    }
+    return block->insts[0].addrs[0];
+}
+
+/*
+ * the blocks are written in the layout order, which is the order of the source for the most part
+ * on the way the jumps are tidied up:
+ * `IF c GOTO T; GOTO X; LABEL T :` becomes `IF !c GOTO X; LABEL T :`,
+ * a jump to the next block is dropped, a fall-through to any other block becomes a jump,
+ * and the labels nothing jumps to are dropped
+ */
+void linearizeCFG(CFG* cfg) {
+    IRFunction* func = cfg->func;
+    int n = cfg->blockNum;
+    int* layout = (int*)malloc((n + 1) * sizeof(int));
+    bool* skipped = (bool*)calloc(n, sizeof(bool));
+    bool* dropJump = (bool*)calloc(n, sizeof(bool));
+    bool* addJump = (bool*)calloc(n, sizeof(bool));
+    int m = 0, k, b;
+    for (b = 0; b < n; b++) {
+        if (cfg->blocks[b].rpo >= 0) { layout[m++] = b; }
+    }
+
+    // the conditional jumps over a forwarder
+    for (k = 0; k + 2 < m; k++) {
+        BasicBlock* block = &cfg->blocks[layout[k]];
+        const BasicBlock* next = &cfg->blocks[layout[k + 1]];
+        Instruction* last = block->instNum == 0 ? NULL : &block->insts[block->instNum - 1];
+        if (skipped[layout[k]] || last == NULL || !isCondGoto(last->tag)) { continue; }
+        if (block->fall != layout[k + 1] || !isForwarder(next) || next->predNum != 1) { continue; }
+        if (jumpTarget(cfg, last) != layout[k + 2]) { continue; }
+        last->tag = negateGoto(last->tag);
+        last->addrs[2] = next->insts[next->instNum - 1].addrs[0];
+        block->fall = layout[k + 2];
+        skipped[layout[k + 1]] = true;
+    }
+    int kept = 0;
+    for (k = 0; k < m; k++) {
+        if (!skipped[layout[k]]) { layout[kept++] = layout[k]; }
+    }
+    m = kept;
+
+    // the jumps to the next block, and the fall-throughs to the others
+    for (k = 0; k < m; k++) {
+        BasicBlock* block = &cfg->blocks[layout[k]];
+        int next = k + 1 < m ? layout[k + 1] : -1;
+        const Instruction* last = lastInst(block);
+        if (last != NULL && last->tag == I_GOTO && jumpTarget(cfg, last) == next) {
+            dropJump[layout[k]] = true;
+        }
+        if (block->fall >= 0 && block->fall != next) {
+            blockLabel(cfg, block->fall);
+            addJump[layout[k]] = true;
+        }
+    }
+
+    // the labels still jumped to
+    int* refs = (int*)calloc(func->labelNum + 1, sizeof(int));
+    int total = 0;
+    for (k = 0; k < m; k++) {
+        const BasicBlock* block = &cfg->blocks[layout[k]];
+        const Instruction* last = lastInst(block);
+        if (last != NULL && jumpLabel(last) != NULL && !dropJump[layout[k]]) {
+            refs[jumpLabel(last)->content.label]++;
+        }
+        if (addJump[layout[k]]) { refs[cfg->blocks[block->fall].insts[0].addrs[0].content.label]++; }
+        total += block->instNum + 1;
+    }
+
+    Instruction* insts = (Instruction*)arenaAlloc(currentArena, (total + 1) * sizeof(Instruction));
+    int num = 0, i;
+    for (k = 0; k < m; k++) {
+        const BasicBlock* block = &cfg->blocks[layout[k]];
+        int from = 0, to = block->instNum;
+        if (to > 0 && block->insts[0].tag == I_LABEL && refs[block->insts[0].addrs[0].content.label] == 0) {
+            from = 1;
+        }
+        if (dropJump[layout[k]]) { to--; }
+        for (i = from; i < to; i++) { insts[num++] = block->insts[i]; }
+        if (addJump[layout[k]]) {
+            insts[num++] = makeUnaryInst(I_GOTO, cfg->blocks[block->fall].insts[0].addrs[0]);
+        }
+    }
+    assert(num > 0 && insts[0].tag == I_FUNC);
+    func->insts = insts;
+    func->instNum = num;
+    func->instCap = total + 1;
+
+    free(layout);
+    free(skipped);
+    free(dropJump);
+    free(addJump);
+    free(refs);
+}
@@ -0,0 +1,53 @@
+#ifndef CFG_H
+#define CFG_H
+
+#include"ir.h"
+
+/*
+ * the control flow graph of a function
+ * a block owns a copy of its instructions, where a label can only be the first one
+ * and a jump or a return only the last one, so the passes can edit the blocks independently
+ * the edges are derived from the last instructions by `connectBlocks`
+ */
+typedef struct BasicBlock {
+    Instruction* insts;
+    int instNum, instCap;
+    int fall;           // the block reached by falling through the end, -1 if none
+    int succs[2];       // the fall-through one first, then the target of the jump
+    int succNum;
+    int* preds;
+    int predNum, predCap;
+    int rpo;            // the position in the reverse postorder, -1 for the unreachable blocks
+} BasicBlock;
+
+typedef struct CFG {
+    IRFunction* func;
+    BasicBlock* blocks;     // in the layout order, the entry first
+    int blockNum, blockCap;
+    int* labelBlock;        // the block each label of the function starts, -1 for the unused ones
+    int* order;             // the reachable blocks in reverse postorder
+    int orderNum;
+} CFG;
+
+// split a function into blocks at the labels & the jumps
+CFG* buildCFG(IRFunction* func);
+// recompute the edges & the order, after the jumps or the blocks are changed
+void connectBlocks(CFG* cfg);
+// a new empty block at the end of the layout, returns its index
+int addBlock(CFG* cfg);
+// the label of a block, which is made when the block has none
+Oprand blockLabel(CFG* cfg, int b);
+/*
+ * a new block on the edge from `from` to `to`, only jumping to `to`, and the phis of `to` read from it instead
+ * the edges are left for `connectBlocks` to recompute
+ */
+int splitEdge(CFG* cfg, int from, int to);
+// the block a jump goes to
+int jumpTarget(const CFG* cfg, const Instruction* i);
+void appendInst(BasicBlock* b, Instruction inst);
+void insertInst(BasicBlock* b, int pos, Instruction inst);
+void removeInst(BasicBlock* b, int pos);
+// write the reachable blocks back into the function, in the layout order
+void linearizeCFG(CFG* cfg);
+
+#endif
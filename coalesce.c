@@ -0,0 +1,340 @@
+#include "coalesce.h"
+#include<assert.h>
+#include<stdlib.h>
+
+// pairs of a key & a value, grouped by the keys afterward
+typedef struct Pairs {
+    int* keys;
+    int* values;
+    int num, cap;
+} Pairs;
+
+static void pushPair(Pairs* p, int key, int value) {
+    if (p->num == p->cap) {
+        p->cap = p->cap == 0 ? 64 : p->cap * 2;
+        p->keys = (int*)realloc(p->keys, p->cap * sizeof(int));
+        p->values = (int*)realloc(p->values, p->cap * sizeof(int));
+    }
+    p->keys[p->num] = key;
+    p->values[p->num] = value;
+    p->num++;
+}
+
+// the values of key `k` are `(*values)[(*start)[k]]` up to `(*values)[(*start)[k + 1]]`, the pairs are freed
+static void groupPairs(Pairs* p, int keyNum, int** start, int** values) {
+    int* s = (int*)calloc(keyNum + 2, sizeof(int));
+    int* fill = (int*)malloc((keyNum + 1) * sizeof(int));
+    int* v = (int*)malloc((p->num + 1) * sizeof(int));
+    int k;
+    for (k = 0; k < p->num; k++) { s[p->keys[k] + 1]++; }
+    for (k = 0; k < keyNum; k++) {
+        s[k + 1] += s[k];
+        fill[k] = s[k];
+    }
+    for (k = 0; k < p->num; k++) { v[fill[p->keys[k]]++] = p->values[k]; }
+    free(fill);
+    free(p->keys);
+    free(p->values);
+    *start = s;
+    *values = v;
+}
+
+// `x := y` between two vregs
+static bool isMove(const Instruction* i) {
+    return (i->tag == I_COPY || i->tag == I_ASSGN) && i->addrs[1].tag == OP_VAR;
+}
+
+typedef struct Coalescer {
+    const CFG* cfg;
+    int vregNum;
+    bool* candidate;    // the vregs which may be merged, the others are left alone
+    int* adjStart;      // the interference among the candidates
+    int* adj;
+    // the classes of the merged vregs, as a union-find forest, with the members listed from the roots
+    int* parent;
+    int* head;
+    int* next;
+    int* tail;
+    int* size;
+    bool* hasParam;     // two parameters are never merged, each one has its own place
+} Coalescer;
+
+static void findCandidates(Coalescer* c, const int* origin, int originNum) {
+    const CFG* cfg = c->cfg;
+    int b, k;
+    c->candidate = (bool*)calloc(c->vregNum + 1, sizeof(bool));
+    for (k = 0; k < originNum; k++) {
+        if (origin[k] != k) { c->candidate[k] = c->candidate[origin[k]] = true; }
+    }
+    for (b = 0; b < cfg->blockNum; b++) {
+        const BasicBlock* block = &cfg->blocks[b];
+        if (block->rpo < 0) { continue; }
+        for (k = 0; k < block->instNum; k++) {
+            const Instruction* i = &block->insts[k];
+            if (isMove(i)) { c->candidate[i->addrs[0].content.vreg] = c->candidate[i->addrs[1].content.vreg] = true; }
+        }
+    }
+    // the arrays are memory
+    for (b = 0; b < cfg->blockNum; b++) {
+        const BasicBlock* block = &cfg->blocks[b];
+        for (k = 0; k < block->instNum; k++) {
+            if (block->insts[k].tag == I_DEC) { c->candidate[block->insts[k].addrs[0].content.vreg] = false; }
+        }
+    }
+}
+
+/*
+ * the blocks each candidate is live out of, as the pairs of a block & a vreg
+ * the liveness is found for each candidate by walking back from the blocks reading it
+ * to those defining it, which stays linear in the live ranges, however many vregs there are
+ */
+static void findLiveOuts(const Coalescer* c, Pairs* outs) {
+    const CFG* cfg = c->cfg;
+    int vregNum = c->vregNum, n = cfg->blockNum, b, k, j, v;
+    Pairs defs = { NULL, NULL, 0, 0 }, exposed = { NULL, NULL, 0, 0 };
+    int* seenDef = (int*)malloc((vregNum + 1) * sizeof(int));
+    int* seenUse = (int*)malloc((vregNum + 1) * sizeof(int));
+    for (k = 0; k < vregNum; k++) { seenDef[k] = seenUse[k] = -1; }
+    // the blocks defining each candidate, and those reading it before defining it
+    for (b = 0; b < n; b++) {
+        const BasicBlock* block = &cfg->blocks[b];
+        if (block->rpo < 0) { continue; }
+        for (k = 0; k < block->instNum; k++) {
+            int uses[3], num = instUses(&block->insts[k], uses), d = instDef(&block->insts[k]);
+            for (j = 0; j < num; j++) {
+                v = uses[j];
+                if (!c->candidate[v] || seenDef[v] == b || seenUse[v] == b) { continue; }
+                seenUse[v] = b;
+                pushPair(&exposed, v, b);
+            }
+            if (d >= 0 && c->candidate[d] && seenDef[d] != b) {
+                seenDef[d] = b;
+                pushPair(&defs, d, b);
+            }
+        }
+    }
+    free(seenDef);
+    free(seenUse);
+    int *defStart, *defBlocks, *exposedStart, *exposedBlocks;
+    groupPairs(&defs, vregNum, &defStart, &defBlocks);
+    groupPairs(&exposed, vregNum, &exposedStart, &exposedBlocks);
+
+    int* defMark = (int*)malloc((n + 1) * sizeof(int));
+    int* inMark = (int*)malloc((n + 1) * sizeof(int));
+    int* outMark = (int*)malloc((n + 1) * sizeof(int));
+    int* work = (int*)malloc((n + 1) * sizeof(int));
+    for (b = 0; b < n; b++) { defMark[b] = inMark[b] = outMark[b] = -1; }
+    for (v = 0; v < vregNum; v++) {
+        int top = 0;
+        for (k = defStart[v]; k < defStart[v + 1]; k++) { defMark[defBlocks[k]] = v; }
+        for (k = exposedStart[v]; k < exposedStart[v + 1]; k++) {
+            inMark[exposedBlocks[k]] = v;
+            work[top++] = exposedBlocks[k];
+        }
+        while (top > 0) {
+            const BasicBlock* block = &cfg->blocks[work[--top]];
+            for (k = 0; k < block->predNum; k++) {
+                int p = block->preds[k];
+                if (cfg->blocks[p].rpo < 0) { continue; }
+                if (outMark[p] != v) {
+                    outMark[p] = v;
+                    pushPair(outs, p, v);
+                }
+                if (defMark[p] != v && inMark[p] != v) {
+                    inMark[p] = v;
+                    work[top++] = p;
+                }
+            }
+        }
+    }
+    free(defStart);
+    free(defBlocks);
+    free(exposedStart);
+    free(exposedBlocks);
+    free(defMark);
+    free(inMark);
+    free(outMark);
+    free(work);
+}
+
+// the live candidates of a point, in a list with the position of each one
+typedef struct LiveList {
+    int* vregs;
+    int num;
+    int* pos;           // -1 for the dead ones
+} LiveList;
+
+static void addLive(LiveList* l, int v) {
+    if (l->pos[v] >= 0) { return; }
+    l->pos[v] = l->num;
+    l->vregs[l->num++] = v;
+}
+
+static void removeLive(LiveList* l, int v) {
+    int p = l->pos[v];
+    if (p < 0) { return; }
+    l->vregs[p] = l->vregs[--l->num];
+    l->pos[l->vregs[p]] = p;
+    l->pos[v] = -1;
+}
+
+static void buildInterference(Coalescer* c) {
+    const CFG* cfg = c->cfg;
+    int vregNum = c->vregNum, b, k, j;
+    Pairs outs = { NULL, NULL, 0, 0 }, edges = { NULL, NULL, 0, 0 };
+    int *outStart, *outVregs;
+    findLiveOuts(c, &outs);
+    groupPairs(&outs, cfg->blockNum, &outStart, &outVregs);
+
+    LiveList live;
+    live.vregs = (int*)malloc((vregNum + 1) * sizeof(int));
+    live.pos = (int*)malloc((vregNum + 1) * sizeof(int));
+    live.num = 0;
+    for (k = 0; k < vregNum; k++) { live.pos[k] = -1; }
+    for (b = 0; b < cfg->blockNum; b++) {
+        const BasicBlock* block = &cfg->blocks[b];
+        if (block->rpo < 0) { continue; }
+        for (k = outStart[b]; k < outStart[b + 1]; k++) { addLive(&live, outVregs[k]); }
+        for (k = block->instNum - 1; k >= 0; k--) {
+            const Instruction* i = &block->insts[k];
+            int d = instDef(i), uses[3], num = instUses(i, uses);
+            if (d >= 0 && c->candidate[d]) {
+                // a copy leaves its source with the same value
+                int src = isMove(i) ? i->addrs[1].content.vreg : -1;
+                for (j = 0; j < live.num; j++) {
+                    int w = live.vregs[j];
+                    if (w == d || w == src) { continue; }
+                    pushPair(&edges, d, w);
+                    pushPair(&edges, w, d);
+                }
+                removeLive(&live, d);
+            }
+            for (j = 0; j < num; j++) {
+                if (c->candidate[uses[j]]) { addLive(&live, uses[j]); }
+            }
+        }
+        while (live.num > 0) { removeLive(&live, live.vregs[live.num - 1]); }
+    }
+    groupPairs(&edges, vregNum, &c->adjStart, &c->adj);
+    free(outStart);
+    free(outVregs);
+    free(live.vregs);
+    free(live.pos);
+}
+
+static int findClass(Coalescer* c, int v) {
+    while (c->parent[v] != v) {
+        c->parent[v] = c->parent[c->parent[v]];
+        v = c->parent[v];
+    }
+    return v;
+}
+
+static bool classesInterfere(Coalescer* c, int ra, int rb) {
+    int x, k;
+    if (c->size[ra] > c->size[rb]) {
+        int t = ra;
+        ra = rb;
+        rb = t;
+    }
+    for (x = c->head[ra]; x >= 0; x = c->next[x]) {
+        for (k = c->adjStart[x]; k < c->adjStart[x + 1]; k++) {
+            if (findClass(c, c->adj[k]) == rb) { return true; }
+        }
+    }
+    return false;
+}
+
+static void tryMerge(Coalescer* c, int a, int b) {
+    if (!c->candidate[a] || !c->candidate[b]) { return; }
+    int ra = findClass(c, a), rb = findClass(c, b);
+    if (ra == rb || (c->hasParam[ra] && c->hasParam[rb]) || classesInterfere(c, ra, rb)) { return; }
+    if (c->size[ra] < c->size[rb]) {
+        int t = ra;
+        ra = rb;
+        rb = t;
+    }
+    c->parent[rb] = ra;
+    c->size[ra] += c->size[rb];
+    c->next[c->tail[ra]] = c->head[rb];
+    c->tail[ra] = c->tail[rb];
+    c->hasParam[ra] = c->hasParam[ra] || c->hasParam[rb];
+}
+
+static void renameOprand(Oprand* op, const int* name) {
+    if (op->tag == OP_VAR) { op->content.vreg = name[op->content.vreg]; }
+}
+
+void coalesceCopies(CFG* cfg, const int* origin, int originNum) {
+    int vregNum = cfg->func->vregNum, b, k, j;
+    Coalescer c;
+    c.cfg = cfg;
+    c.vregNum = vregNum;
+    findCandidates(&c, origin, originNum);
+    buildInterference(&c);
+
+    c.parent = (int*)malloc((vregNum + 1) * sizeof(int));
+    c.head = (int*)malloc((vregNum + 1) * sizeof(int));
+    c.next = (int*)malloc((vregNum + 1) * sizeof(int));
+    c.tail = (int*)malloc((vregNum + 1) * sizeof(int));
+    c.size = (int*)malloc((vregNum + 1) * sizeof(int));
+    c.hasParam = (bool*)calloc(vregNum + 1, sizeof(bool));
+    for (k = 0; k < vregNum; k++) {
+        c.parent[k] = c.head[k] = c.tail[k] = k;
+        c.next[k] = -1;
+        c.size[k] = 1;
+    }
+    for (b = 0; b < cfg->blockNum; b++) {
+        const BasicBlock* block = &cfg->blocks[b];
+        for (k = 0; k < block->instNum; k++) {
+            if (block->insts[k].tag == I_PARAM) { c.hasParam[block->insts[k].addrs[0].content.vreg] = true; }
+        }
+    }
+
+    // the names of a vreg first, which are all joined by the copies of the phis
+    for (k = 0; k < originNum && k < vregNum; k++) {
+        if (origin[k] != k) { tryMerge(&c, k, origin[k]); }
+    }
+    for (b = 0; b < cfg->blockNum; b++) {
+        const BasicBlock* block = &cfg->blocks[b];
+        if (block->rpo < 0) { continue; }
+        for (k = 0; k < block->instNum; k++) {
+            const Instruction* i = &block->insts[k];
+            if (isMove(i)) { tryMerge(&c, i->addrs[0].content.vreg, i->addrs[1].content.vreg); }
+        }
+    }
+
+    // each class takes the name of its first vreg, a variable of the source if there is one
+    int* first = (int*)malloc((vregNum + 1) * sizeof(int));
+    int* name = (int*)malloc((vregNum + 1) * sizeof(int));
+    for (k = 0; k < vregNum; k++) { first[k] = -1; }
+    for (k = 0; k < vregNum; k++) {
+        int r = findClass(&c, k);
+        if (first[r] < 0) { first[r] = k; }
+        name[k] = first[r];
+    }
+    for (b = 0; b < cfg->blockNum; b++) {
+        BasicBlock* block = &cfg->blocks[b];
+        int kept = 0;
+        for (k = 0; k < block->instNum; k++) {
+            Instruction* i = &block->insts[k];
+            int slots[3], num = useSlots(i, slots);
+            if (instDef(i) >= 0) { renameOprand(&i->addrs[0], name); }
+            for (j = 0; j < num; j++) { renameOprand(&i->addrs[slots[j]], name); }
+            if (isMove(i) && i->addrs[0].content.vreg == i->addrs[1].content.vreg) { continue; }
+            block->insts[kept++] = *i;
+        }
+        block->instNum = kept;
+    }
+    free(first);
+    free(name);
+    free(c.candidate);
+    free(c.adjStart);
+    free(c.adj);
+    free(c.parent);
+    free(c.head);
+    free(c.next);
+    free(c.tail);
+    free(c.size);
+    free(c.hasParam);
+}
@@ -0,0 +1,14 @@
+#ifndef COALESCE_H
+#define COALESCE_H
+
+#include"cfg.h"
+
+/*
+ * the coalescing of the vregs joined by copies, after the translation out of SSA
+ * two vregs interfere when one is defined where the other is live, except by a copy between them,
+ * and the vregs never interfering are merged into one, and the copies between them are dropped
+ * the names of a vreg made by the renaming are tried first, `origin` giving the vreg of each one
+ */
+void coalesceCopies(CFG* cfg, const int* origin, int originNum);
+
+#endif
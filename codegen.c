@@ -1,21 +1,19 @@
 #include "codegen.h"
+#include "report.h"
 #include<assert.h>
 #include<string.h>
 
-const char* t1 = "$t1";
-const char* t2 = "$t2";
-
-void printInst(FILE* out, const Instruction* i);
+void printInst(FILE* out, const IRFunction* func, const Instruction* i);
 
 // print the offset table for debugging
 void printOffsetTable(const OffsetTable table) {
-    printf("\ttable size %d\n", table.size);
+    printf("\tvreg num %d\n", table.vregNum);
     printf("\tpara num: %d\n", table.paramnum);
     int i;
-    for (i = 0; i < table.size; i++) {
-        printf("\tvar: %s, offset: %d\n", table.table[i].name, table.table[i].offset);
+    for (i = 0; i < table.vregNum; i++) {
+        if (table.offsets[i] != 0) { printf("\tvar: %d, offset: %d\n", i, table.offsets[i]); }
     }
-    printf("\tthe end offset is: %d\n", table.table[table.size].offset);
+    printf("\tthe end offset is: %d\n", table.end);
 }
 
 /*
@@ -53,13 +51,13 @@ after return:
     10. $ra <- 0($sp)
     11. $sp <- $sp + 4 * (arg num + 1)
 */
-// a helper function, to get the variable info from a defininition
-// the result's `name` field for the variable name, and `offset` for its size
-// when the input is not a definition, it returns { name = NULL, offset = 0 }
-NameOffsetPair getDefVar(const Instruction* i) {
-    NameOffsetPair res;
+// a helper function, to get the variable defined by an instruction
+// returns its vreg and sets `size` to its size: -4 for a variable, -n for a DEC of n bytes
+// and 4 for a parameter, or returns -1 when the input is not a definition
+int getDefVar(const Instruction* i, int* size) {
     switch (i->tag) {
     case I_ASSGN:
+    case I_COPY:
     case I_ADD:
     case I_SUB:
     case I_MUL:
@@ -68,316 +66,369 @@ NameOffsetPair getDefVar(const Instruction* i) {
     case I_LOAD:
     case I_CALL:
     case I_READ:
-        res.name = i->addrs[0]->content.name;
-        res.offset = -4;
-        res.isparam = false;
-        break;
+        *size = -4;
+        return i->addrs[0].content.vreg;
     case I_DEC:
         // according to the semantics of DEC v, v is the first var of the array
         // but in this compiler, this v is never used expect for loading it's address
         // thus, we just assign the array size to the v's size, which reserves the array's memory
         // and v occupies no memory, which is reasonable
-        res.name = i->addrs[0]->content.name;
-        res.offset = -i->addrs[1]->content.lit;
-        res.isparam = false;
-        break;
+        *size = -i->addrs[1].content.lit;
+        return i->addrs[0].content.vreg;
     case I_PARAM:
         // all the arguments will be in the stack for simplicity
-        res.name = i->addrs[0]->content.name;
-        res.offset = 4;
-        res.isparam = true;
-        break;
+        *size = 4;
+        return i->addrs[0].content.vreg;
     default:
         // TODO: check other instructions
-        res.name = NULL;
-        res.offset = 0;
-        res.isparam = false;
-        break;
+        *size = 0;
+        return -1;
     }
-    return res;
 }
 
-// return a variable offset table of a given function
-// it's designed as an array on the heap, for easy allocation & free
-OffsetTable makeFuncVarTable(const IRNode* begin, const IRNode* end) {
-    int len = 0;
-    const IRNode* p;
-    // the length of the function, an upper bound of var num
-    for (p = begin; p != end; p = p->next) {
-        len++;
-    }
-
-    NameOffsetPair* table;
-    int size = 0;
-    int paramnum = 0;
-    table = (NameOffsetPair*)malloc(len * sizeof(NameOffsetPair));
+// the state of placing the variables one after another
+typedef struct FrameLayout {
+    int* offsets;
+    int last;           // the variable placed last
+    int lastOffset;     // the size of the last one
+    bool firstVar;
+    int paramnum;
+} FrameLayout;
 
-    bool firstVar = true;
-    int lastOffset = 0;
-    for (p = begin; p != end; p = p->next) {
-        NameOffsetPair var_info = getDefVar(p->inst);
-        if (var_info.name != NULL) {
-            int i;
-            bool in_table = false;
-            for (i = 0; i < size; i++) {
-                if (strcmp(table[i].name, var_info.name) == 0) {
-                    in_table = true;
-                    break;
-                }
-            }
-
-            // push a new variable into the table 
-            if (!in_table) {
-                table[size].name = var_info.name;
-                // HACK: note that the PARAM declarations should always at the front
-                // the offset field is a prefix sum
-                // params' offsets are positive, and variables' are negative
-                if (var_info.isparam) {
-                    if (size == 0) {
-                        // set the start address of the parameters
-                        table[size].offset = 8;
-                    }
-                    else {
-                        table[size].offset = lastOffset
-                            + table[size - 1].offset;
-                    }
-                    paramnum++;
-                }
-                else {
-                    if (firstVar) {
-                        // set the start address of the variables
-                        table[size].offset = -4;
-                        firstVar = false;
-                    }
-                    else {
-                        table[size].offset = lastOffset
-                            + table[size - 1].offset;
-                    }
-                    // HACK: note that the stack grows to the lower address
-                    // but arrays grows to the higher
-                    // here is a hack to make array var point to it's first element
-                    // the adjustment has to be done after the next offset is set
-                    if (-lastOffset > 4) { // the last entry is an array
-                        table[size-1].offset = table[size].offset + 4;
-                    }
-                }
-                lastOffset = var_info.offset;
-                size++;
-            }
+static void placeVar(FrameLayout* l, int v, int size) {
+    int* offsets = l->offsets;
+    // HACK: note that the PARAM declarations should always at the front
+    // the offset is a prefix sum
+    // params' offsets are positive, and variables' are negative
+    if (size > 0) {
+        // set the start address of the parameters
+        offsets[v] = l->last < 0 ? 8 : l->lastOffset + offsets[l->last];
+        l->paramnum++;
+    }
+    else {
+        if (l->firstVar) {
+            // set the start address of the variables
+            offsets[v] = -4;
+            l->firstVar = false;
+        }
+        else {
+            offsets[v] = l->lastOffset + offsets[l->last];
+        }
+        // HACK: note that the stack grows to the lower address
+        // but arrays grows to the higher
+        // here is a hack to make array var point to it's first element
+        // the adjustment has to be done after the next offset is set
+        if (-l->lastOffset > 4) { // the last entry is an array
+            offsets[l->last] = offsets[v] + 4;
         }
     }
+    l->lastOffset = size;
+    l->last = v;
+}
 
-    // HACK: the last one is a dummy entry with name=NULL, 
-    // and offset=the end of all local vars, for $sp initialization
-    table[size].name = NULL;
-    if (size == 0) {
-        table[size].offset = 0;
+// return a variable offset table of a given function
+// the offsets are an array on the heap indexed by the vregs, for easy allocation & free
+// 0 is never an offset of a variable, so it marks the ones not placed yet
+OffsetTable makeFuncVarTable(const IRFunction* func) {
+    FrameLayout l;
+    l.offsets = (int*)calloc(func->vregNum + 1, sizeof(int));
+    l.last = -1;
+    l.lastOffset = 0;
+    l.firstVar = true;
+    l.paramnum = 0;
+    const Instruction* p;
+    const Instruction* end = func->insts + func->instNum;
+
+    for (p = func->insts; p != end; p++) {
+        int size;
+        int v = getDefVar(p, &size);
+        if (v < 0 || l.offsets[v] != 0) { continue; }
+        assert(v < func->vregNum);
+        placeVar(&l, v, size);
     }
-    else {
-        table[size].offset = lastOffset + table[size - 1].offset;
+    // a variable read but never written, when its definitions are optimized away as unreachable
+    for (p = func->insts; p != end; p++) {
+        int uses[3];
+        int n = instUses(p, uses), k;
+        for (k = 0; k < n; k++) {
+            if (l.offsets[uses[k]] == 0) { placeVar(&l, uses[k], -4); }
+        }
     }
 
-    // then all the variables are collected, the no replicated
     OffsetTable res;
-    res.table = table;
-    res.size = size;
-    res.paramnum = paramnum;
-    res.ismain = strcmp(begin->inst->addrs[0]->content.label, "main") == 0;
+    res.offsets = l.offsets;
+    res.vregNum = func->vregNum;
+    // the end of all local vars, for $sp initialization
+    res.end = l.last < 0 ? 0 : l.lastOffset + l.offsets[l.last];
+    res.labelBase = func->labelBase;
+    res.paramnum = l.paramnum;
+    res.ismain = func->name == atomMain;
     return res;
 }
 
-// a helper function to get the code fragment of a given function
-// return the **next** instruction of the function
-// for the last function, it is `NULL`
-IRNode* getFunctionEnd(const IRNode* begin) {
-    assert(begin->inst->tag == I_FUNC);
-    IRNode* p = begin->next;
-    for (; p != NULL && p->inst->tag != I_FUNC; p = p->next);
-    return p;
+// the offset of a variable to $fp
+int getOffsetEntry(const OffsetTable table, const Oprand* op) {
+    assert(op->tag == OP_VAR);
+    assert(op->content.vreg < table.vregNum && table.offsets[op->content.vreg] != 0);
+    return table.offsets[op->content.vreg];
 }
 
-NameOffsetPair getOffsetEntry(const OffsetTable table, const char* name) {
-    int i;
-    for (i = 0; i < table.size; i++) {
-        if (strcmp(table.table[i].name, name) == 0) {
-            return table.table[i];
-        }
-    }
-    assert(0);
+// the registers used by the generated code
+static const char* regNames[] = { "$0", "$v0", "$a0", "$t1", "$t2", "$sp", "$fp", "$ra" };
+
+static inline void emitReg(AsmWriter* w, Reg r) {
+    emitStr(w, regNames[r]);
+}
+
+// the shapes of the instructions, e.g. `emitRRI(w, "addi", R_T1, R_T1, 4)` for `addi $t1, $t1, 4`
+static void emitR(AsmWriter* w, const char* inst, Reg r) {
+    emitChar(w, '\t');
+    emitStr(w, inst);
+    emitChar(w, ' ');
+    emitReg(w, r);
+    emitChar(w, '\n');
+}
+
+static void emitRR(AsmWriter* w, const char* inst, Reg r1, Reg r2) {
+    emitChar(w, '\t');
+    emitStr(w, inst);
+    emitChar(w, ' ');
+    emitReg(w, r1);
+    emitStr(w, ", ");
+    emitReg(w, r2);
+    emitChar(w, '\n');
+}
+
+static void emitRRR(AsmWriter* w, const char* inst, Reg r1, Reg r2, Reg r3) {
+    emitChar(w, '\t');
+    emitStr(w, inst);
+    emitChar(w, ' ');
+    emitReg(w, r1);
+    emitStr(w, ", ");
+    emitReg(w, r2);
+    emitStr(w, ", ");
+    emitReg(w, r3);
+    emitChar(w, '\n');
+}
+
+static void emitRI(AsmWriter* w, const char* inst, Reg r, int imm) {
+    emitChar(w, '\t');
+    emitStr(w, inst);
+    emitChar(w, ' ');
+    emitReg(w, r);
+    emitStr(w, ", ");
+    emitInt(w, imm);
+    emitChar(w, '\n');
+}
+
+static void emitRRI(AsmWriter* w, const char* inst, Reg r1, Reg r2, int imm) {
+    emitChar(w, '\t');
+    emitStr(w, inst);
+    emitChar(w, ' ');
+    emitReg(w, r1);
+    emitStr(w, ", ");
+    emitReg(w, r2);
+    emitStr(w, ", ");
+    emitInt(w, imm);
+    emitChar(w, '\n');
+}
+
+// load & store, `inst r, offset(base)`
+static void emitMem(AsmWriter* w, const char* inst, Reg r, int offset, Reg base) {
+    emitChar(w, '\t');
+    emitStr(w, inst);
+    emitChar(w, ' ');
+    emitReg(w, r);
+    emitStr(w, ", ");
+    emitInt(w, offset);
+    emitChar(w, '(');
+    emitReg(w, base);
+    emitStr(w, ")\n");
+}
+
+// the label oprands are numbered within the function, the names in the assembly are unique
+static void emitLabelName(AsmWriter* w, const OffsetTable* table, const Oprand* label) {
+    assert(label->tag == OP_LABEL);
+    emitStr(w, "label");
+    emitHex(w, (unsigned)(table->labelBase + label->content.label));
+}
+
+static void emitJump(AsmWriter* w, const char* inst, const OffsetTable* table, const Oprand* label) {
+    emitChar(w, '\t');
+    emitStr(w, inst);
+    emitChar(w, ' ');
+    emitLabelName(w, table, label);
+    emitChar(w, '\n');
 }
 
 // generate code for var op & lit which needs to be loaded to a reg
 // and return the reg (string)
 // since instructions have at most 2 oprands
 // `pos` decides which reg to choose
-void oprandLoad(FILE* out, const OffsetTable table, Oprand* op, const char* reg) {
-    assert(op->tag != OP_LABEL);
+void oprandLoad(AsmWriter* w, const OffsetTable table, const Oprand* op, Reg reg) {
+    assert(op->tag == OP_LIT || op->tag == OP_VAR);
     if (op->tag == OP_LIT) {
-        fprintf(out, "\tli %s, %d\n", reg, op->content.lit);
+        emitRI(w, "li", reg, op->content.lit);
     }
     else {
-        NameOffsetPair e = getOffsetEntry(table, op->content.name);
         // then load offset($fp) to the destination
-        fprintf(out, "\tlw %s, %d($fp)\n", reg, e.offset);
+        emitMem(w, "lw", reg, getOffsetEntry(table, op), R_FP);
     }
 }
 
-void oprandSave(FILE* out, const OffsetTable table, Oprand* op, const char* reg) {
-    assert(op->tag == OP_VAR);
-    NameOffsetPair e = getOffsetEntry(table, op->content.name);
-    fprintf(out, "\tsw %s, %d($fp)\n", reg, e.offset);
+void oprandSave(AsmWriter* w, const OffsetTable table, const Oprand* op, Reg reg) {
+    emitMem(w, "sw", reg, getOffsetEntry(table, op), R_FP);
 }
 
-void generateGoto(FILE* out, const OffsetTable table, const Instruction* i, char* inst) {
-    oprandLoad(out, table, i->addrs[0], t1);
-    oprandLoad(out, table, i->addrs[1], t2);
-    fprintf(out, "\t%s %s, %s, %s\n", inst, t1, t2, i->addrs[2]->content.label);
+void generateGoto(AsmWriter* w, const OffsetTable table, const Instruction* i, char* inst) {
+    oprandLoad(w, table, &i->addrs[0], R_T1);
+    oprandLoad(w, table, &i->addrs[1], R_T2);
+    emitChar(w, '\t');
+    emitStr(w, inst);
+    emitChar(w, ' ');
+    emitReg(w, R_T1);
+    emitStr(w, ", ");
+    emitReg(w, R_T2);
+    emitStr(w, ", ");
+    emitLabelName(w, &table, &i->addrs[2]);
+    emitChar(w, '\n');
 }
 
 // the ad hoc code for read write functions
-void initSyscall(FILE* out) {
-    fprintf(out, "read:\n\tli $v0, 4\n\tla $a0, _prompt\n\tsyscall\n\tli $v0, 5\n\tsyscall\n\tjr $ra\n");
-    fprintf(out, "write:\n\tli $v0, 1\n\tsyscall\n\tli $v0, 4\n\tla $a0, _ret\n\tsyscall\n\tmove $v0, $0\n\tjr $ra\n");
+void initSyscall(AsmWriter* w) {
+    emitStr(w, "read:\n\tli $v0, 4\n\tla $a0, _prompt\n\tsyscall\n\tli $v0, 5\n\tsyscall\n\tjr $ra\n");
+    emitStr(w, "write:\n\tli $v0, 1\n\tsyscall\n\tli $v0, 4\n\tla $a0, _ret\n\tsyscall\n\tmove $v0, $0\n\tjr $ra\n");
 }
 
-// this function is designed to be called in the instruction order only
-// calls out of order would lead to unexpected behaviors
-void generateInst(FILE* out, const IRNode* irn) {
-    // the table is managed by this function itself
-    // it updates the table when it enters a new function,
-    // and delete the old one
-    // for a pseudo one-pass implementation
-    static OffsetTable table;
-    static bool is_first = true;
-    const Instruction* i = irn->inst;
-
+// `table` holds the offset table of the function the instruction is in
+void generateInst(AsmWriter* w, OffsetTable* table, const Instruction* i) {
     switch (i->tag) {
     case I_LABEL:
-        fprintf(out, "%s:\n", i->addrs[0]->content.label);
+        emitLabelName(w, table, &i->addrs[0]);
+        emitStr(w, ":\n");
         break;
     case I_FUNC:
-        // first clean the old table
-        if (is_first) { is_first = false; }
-        else { free(table.table); }
-        table = makeFuncVarTable(irn, getFunctionEnd(irn));
         // init func here
-        fprintf(out, "\n%s:\n", i->addrs[0]->content.label);
-        if (table.ismain) {
+        emitChar(w, '\n');
+        emitStr(w, i->addrs[0].content.func);
+        emitStr(w, ":\n");
+        if (table->ismain) {
             // HACK: $fp initialization is needed
             // since the ret addr is not needed for main, 
             // we can cancel this by adding the offset back to $fp
-            fprintf(out, "\taddi $fp, $sp, %d\n", 4);
+            emitRRI(w, "addi", R_FP, R_SP, 4);
         }
         // step 6: push auto vars
-        fprintf(out, "\taddi $sp, $fp, %d\n", table.table[table.size].offset);
-        // printOffsetTable(table);
+        emitRRI(w, "addi", R_SP, R_FP, table->end);
+        // printOffsetTable(*table);
         break;
     case I_ASSGN:
-        oprandLoad(out, table, i->addrs[1], t1);
-        oprandSave(out, table, i->addrs[0], t1);
+    case I_COPY:
+        oprandLoad(w, *table, &i->addrs[1], R_T1);
+        oprandSave(w, *table, &i->addrs[0], R_T1);
         break;
     case I_ADD:
         // since constant folding is performed, then there would be at most 1 lit-op
-        if (i->addrs[2]->tag == OP_LIT) {
-            oprandLoad(out, table, i->addrs[1], t1);
-            fprintf(out, "\taddi %s, %s, %d\n", t1, t1, i->addrs[2]->content.lit);
-            oprandSave(out, table, i->addrs[0], t1);
+        if (i->addrs[2].tag == OP_LIT) {
+            oprandLoad(w, *table, &i->addrs[1], R_T1);
+            emitRRI(w, "addi", R_T1, R_T1, i->addrs[2].content.lit);
+            oprandSave(w, *table, &i->addrs[0], R_T1);
         }
         else {
-            if (i->addrs[1]->tag == OP_LIT) {
-                oprandLoad(out, table, i->addrs[2], t1);
-                fprintf(out, "\taddi %s, %s, %d\n", t1, t1, i->addrs[1]->content.lit);
-                oprandSave(out, table, i->addrs[0], t1);
+            if (i->addrs[1].tag == OP_LIT) {
+                oprandLoad(w, *table, &i->addrs[2], R_T1);
+                emitRRI(w, "addi", R_T1, R_T1, i->addrs[1].content.lit);
+                oprandSave(w, *table, &i->addrs[0], R_T1);
             }
             else {
-                oprandLoad(out, table, i->addrs[1], t1);
-                oprandLoad(out, table, i->addrs[2], t2);
-                fprintf(out, "\tadd %s, %s, %s\n", t1, t1, t2);
-                oprandSave(out, table, i->addrs[0], t1);
+                oprandLoad(w, *table, &i->addrs[1], R_T1);
+                oprandLoad(w, *table, &i->addrs[2], R_T2);
+                emitRRR(w, "add", R_T1, R_T1, R_T2);
+                oprandSave(w, *table, &i->addrs[0], R_T1);
             }
         }
         break;
     case I_SUB:
-        if (i->addrs[2]->tag == OP_LIT) {
-            oprandLoad(out, table, i->addrs[1], t1);
-            fprintf(out, "\taddi %s, %s, %d\n", t1, t1, -i->addrs[2]->content.lit);
-            oprandSave(out, table, i->addrs[0], t1);
+        if (i->addrs[2].tag == OP_LIT) {
+            oprandLoad(w, *table, &i->addrs[1], R_T1);
+            emitRRI(w, "addi", R_T1, R_T1, -i->addrs[2].content.lit);
+            oprandSave(w, *table, &i->addrs[0], R_T1);
         }
         else {
-            oprandLoad(out, table, i->addrs[1], t1);
-            oprandLoad(out, table, i->addrs[2], t2);
-            fprintf(out, "\tsub %s, %s, %s\n", t1, t1, t2);
-            oprandSave(out, table, i->addrs[0], t1);
+            oprandLoad(w, *table, &i->addrs[1], R_T1);
+            oprandLoad(w, *table, &i->addrs[2], R_T2);
+            emitRRR(w, "sub", R_T1, R_T1, R_T2);
+            oprandSave(w, *table, &i->addrs[0], R_T1);
         }
         break;
     case I_MUL:
     {
-        oprandLoad(out, table, i->addrs[1], t1);
-        oprandLoad(out, table, i->addrs[2], t2);
-        fprintf(out, "\tmul %s, %s, %s\n", t1, t1, t2);
-        oprandSave(out, table, i->addrs[0], t1);
+        oprandLoad(w, *table, &i->addrs[1], R_T1);
+        oprandLoad(w, *table, &i->addrs[2], R_T2);
+        emitRRR(w, "mul", R_T1, R_T1, R_T2);
+        oprandSave(w, *table, &i->addrs[0], R_T1);
         break;
     }
     case I_DIV:
     {
-        oprandLoad(out, table, i->addrs[1], t1);
-        oprandLoad(out, table, i->addrs[2], t2);
-        fprintf(out, "\tdiv %s, %s\n", t1, t2);
-        fprintf(out, "\tmflo %s\n", t1);
-        oprandSave(out, table, i->addrs[0], t1);
+        oprandLoad(w, *table, &i->addrs[1], R_T1);
+        oprandLoad(w, *table, &i->addrs[2], R_T2);
+        emitRR(w, "div", R_T1, R_T2);
+        emitR(w, "mflo", R_T1);
+        oprandSave(w, *table, &i->addrs[0], R_T1);
         break;
     }
     case I_ADDR:
     {
-        NameOffsetPair e = getOffsetEntry(table, i->addrs[1]->content.name);
-        fprintf(out, "\taddi %s, $fp, %d\n", t1, e.offset);
-        oprandSave(out, table, i->addrs[0], t1);
+        emitRRI(w, "addi", R_T1, R_FP, getOffsetEntry(*table, &i->addrs[1]));
+        oprandSave(w, *table, &i->addrs[0], R_T1);
         break;
     }
     case I_LOAD:
-        oprandLoad(out, table, i->addrs[1], t1);
-        fprintf(out, "\tlw %s, 0(%s)\n", t1, t1);
-        oprandSave(out, table, i->addrs[0], t1);
+        // the constant offset is taken by the instruction itself
+        oprandLoad(w, *table, &i->addrs[1], R_T1);
+        emitMem(w, "lw", R_T1, i->addrs[2].content.lit, R_T1);
+        oprandSave(w, *table, &i->addrs[0], R_T1);
         break;
     case I_SAVE:
-        oprandLoad(out, table, i->addrs[0], t1);
-        oprandLoad(out, table, i->addrs[1], t2);
-        fprintf(out, "\tsw %s, 0(%s)\n", t2, t1);
+        oprandLoad(w, *table, &i->addrs[0], R_T1);
+        oprandLoad(w, *table, &i->addrs[1], R_T2);
+        emitMem(w, "sw", R_T2, i->addrs[2].content.lit, R_T1);
         break;
     case I_GOTO:
-        fprintf(out, "\tj %s\n", i->addrs[0]->content.label);
+        emitJump(w, "j", table, &i->addrs[0]);
         break;
     case I_EQGOTO:
-        generateGoto(out, table, i, "beq");
+        generateGoto(w, *table, i, "beq");
         break;
     case I_NEGOTO:
-        generateGoto(out, table, i, "bne");
+        generateGoto(w, *table, i, "bne");
         break;
     case I_LTGOTO:
-        generateGoto(out, table, i, "blt");
+        generateGoto(w, *table, i, "blt");
         break;
     case I_GTGOTO:
-        generateGoto(out, table, i, "bgt");
+        generateGoto(w, *table, i, "bgt");
         break;
     case I_LEGOTO:
-        generateGoto(out, table, i, "ble");
+        generateGoto(w, *table, i, "ble");
         break;
     case I_GEGOTO:
-        generateGoto(out, table, i, "bge");
+        generateGoto(w, *table, i, "bge");
         break;
     case I_RET:
-        if (table.ismain) {
-            fprintf(out, "\tmove $v0, $0\n\tjr $ra\n");
+        if (table->ismain) {
+            emitStr(w, "\tmove $v0, $0\n\tjr $ra\n");
         }
         else {
             // step 7: $sp <- $fp
-            fprintf(out, "\tmove $sp, $fp\n");
+            emitRR(w, "move", R_SP, R_FP);
             // note that load is depends on $fp
-            oprandLoad(out, table, i->addrs[0], "$v0");
+            oprandLoad(w, *table, &i->addrs[0], R_V0);
             // step 8: recover $fp
-            fprintf(out, "\tlw $fp, 4($fp)\n");
+            emitMem(w, "lw", R_FP, 4, R_FP);
             // step 9: jump
-            fprintf(out, "\tjr $ra\n");
+            emitR(w, "jr", R_RA);
         }
         break;
     case I_DEC:
@@ -387,42 +438,45 @@ void generateInst(FILE* out, const IRNode* irn) {
         // step1: push args, but leave $sp unset
         // sw arg_i, ((i+1-n)*4)($sp)
     {
-        int offset_to_sp = (i->addrs[1]->content.lit + 1 - table.paramnum) * 4;
-        oprandLoad(out, table, i->addrs[0], t1);
-        fprintf(out, "\tsw %s, %d($sp)\n", t1, offset_to_sp);
+        int offset_to_sp = (i->addrs[1].content.lit + 1 - table->paramnum) * 4;
+        oprandLoad(w, *table, &i->addrs[0], R_T1);
+        emitMem(w, "sw", R_T1, offset_to_sp, R_SP);
         break;
     }
     case I_CALL:
         // step1 cont.: set $sp <- $sp - 4*-(n+1), for params & old fp
-        fprintf(out, "\taddi $sp, $sp, %d\n", 4 * -(table.paramnum + 1));
+        emitRRI(w, "addi", R_SP, R_SP, 4 * -(table->paramnum + 1));
         // step2: push $fp
-        fprintf(out, "\tsw $fp, 4($sp)\n");
+        emitMem(w, "sw", R_FP, 4, R_SP);
         // step3: $fp <- $sp
-        fprintf(out, "\tmove $fp, $sp\n");
+        emitRR(w, "move", R_FP, R_SP);
         // step4: push $ra
-        fprintf(out, "\tsw $ra, 0($fp)\n");
-        fprintf(out, "\taddi $sp, $sp, -4\n");
+        emitMem(w, "sw", R_RA, 0, R_FP);
+        emitRRI(w, "addi", R_SP, R_SP, -4);
         // step5: jump
-        fprintf(out, "\tjal %s\n", i->addrs[1]->content.label);
+        emitChar(w, '\t');
+        emitStr(w, "jal ");
+        emitStr(w, i->addrs[1].content.func);
+        emitChar(w, '\n');
         // step 10: recover $ra
-        fprintf(out, "\tlw $ra, 0($sp)\n");
+        emitMem(w, "lw", R_RA, 0, R_SP);
         // step 11: pop old fp & args
-        fprintf(out, "\taddi $sp, $sp, %d\n", 4 * (table.paramnum + 1));
-        fprintf(out, "\tmove %s, $v0\n", t1);
-        oprandSave(out, table, i->addrs[0], t1);
+        emitRRI(w, "addi", R_SP, R_SP, 4 * (table->paramnum + 1));
+        emitRR(w, "move", R_T1, R_V0);
+        oprandSave(w, *table, &i->addrs[0], R_T1);
         break;
     case I_PARAM:
         // do nothing
         break;
         // the implementation for read & write is quite ad hoc
     case I_READ:
-        fprintf(out, "\taddi $sp, $sp, -4\n\tsw $ra, 0($sp)\n\tjal read\n"
+        emitStr(w, "\taddi $sp, $sp, -4\n\tsw $ra, 0($sp)\n\tjal read\n"
             "\tlw $ra, 0($sp)\n\taddi $sp, $sp, 4\n");
-        oprandSave(out, table, i->addrs[0], "$v0");
+        oprandSave(w, *table, &i->addrs[0], R_V0);
         break;
     case I_WRITE:
-        oprandLoad(out, table, i->addrs[0], "$a0");
-        fprintf(out, "\taddi $sp, $sp, -4\n\tsw $ra, 0($sp)\n\tjal write\n"
+        oprandLoad(w, *table, &i->addrs[0], R_A0);
+        emitStr(w, "\taddi $sp, $sp, -4\n\tsw $ra, 0($sp)\n\tjal write\n"
             "\tlw $ra, 0($sp)\n\taddi $sp, $sp, 4\n");
         break;
     default:
@@ -430,18 +484,30 @@ void generateInst(FILE* out, const IRNode* irn) {
     }
 }
 
-void generateCode(FILE* out, const IR* ir) {
+bool generateCode(FILE* out, FILE* tee, const IR* ir) {
+    // the writer is local to this program, so programs can be generated concurrently
+    AsmWriter* w = (AsmWriter*)malloc(sizeof(AsmWriter));
+    initAsmWriter(w, out, tee);
     // template codes
-    fprintf(out, ".data\n_prompt: .asciiz \"Enter an integer:\"\n");
-    fprintf(out, "_ret: .asciiz \"\\n\"\n");
-    fprintf(out, ".globl main\n.text\n");
-    initSyscall(out);
+    emitStr(w, ".data\n_prompt: .asciiz \"Enter an integer:\"\n");
+    emitStr(w, "_ret: .asciiz \"\\n\"\n");
+    emitStr(w, ".globl main\n.text\n");
+    initSyscall(w);
 
-    IRNode* i;
-    // skip the first dummy node
-    for (i = ir->head->next; i != NULL; i = i->next) {
-        // printInst(stdout, i->inst);
-        // printf("\n");
-        generateInst(out, i);
+    int f, k;
+    for (f = 0; f < ir->funcNum; f++) {
+        const IRFunction* func = &ir->funcs[f];
+        beginSpan(func->name);
+        // the table is local to this function
+        OffsetTable table = makeFuncVarTable(func);
+        for (k = 0; k < func->instNum; k++) {
+            generateInst(w, &table, &func->insts[k]);
+        }
+        free(table.offsets);
+        endSpan();
     }
-}
\ No newline at end of file
+    flushAsmWriter(w);
+    bool ok = !w->failed;
+    free(w);
+    return ok;
+}
@@ -2,22 +2,23 @@
 #define CODEGEN_H
 
 #include"ir.h"
+#include"asmwriter.h"
 
-// the function variable offset table entry struct
-typedef struct NameOffsetPair {
-    char* name;
-    int offset;
-    bool isparam;
-} NameOffsetPair;
-
+// the frame of a function, indexed by the vregs
 typedef struct OffsetTable {
-    NameOffsetPair* table;
-    int size;
+    int* offsets;   // the offset to $fp of each vreg, 0 for the ones never defined
+    int vregNum;
+    int end;        // the end of all the local variables, for $sp initialization
+    int labelBase;  // the number of the first label of the function
     int paramnum;   // number of parameter of the function
     bool ismain;
 } OffsetTable;
 
-void generateInst(FILE* out, const IRNode* i);
-void generateCode(FILE* out, const IR* ir);
+// the registers, `$0` is the constant zero
+typedef enum Reg { R_ZERO, R_V0, R_A0, R_T1, R_T2, R_SP, R_FP, R_RA } Reg;
+
+void generateInst(AsmWriter* w, OffsetTable* table, const Instruction* i);
+// write the assembly to `out`, and to `tee` unless NULL, false when any write fails
+bool generateCode(FILE* out, FILE* tee, const IR* ir);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "copyprop.h"
+#include "ssa.h"
+#include<stdlib.h>
+
+static bool isLit(const Oprand* op, int lit) {
+    return op->tag == OP_LIT && op->content.lit == lit;
+}
+
+// the vreg an instruction copies, -1 if none, which includes `y + 0`, `y * 1` and the like
+static int copiedVreg(const Instruction* i) {
+    const Oprand* a = &i->addrs[1];
+    const Oprand* b = &i->addrs[2];
+    switch (i->tag) {
+    case I_ASSGN: case I_COPY:
+        break;
+    case I_ADD:
+        if (isLit(a, 0)) { a = b; }
+        else if (!isLit(b, 0)) { return -1; }
+        break;
+    case I_MUL:
+        if (isLit(a, 1)) { a = b; }
+        else if (!isLit(b, 1)) { return -1; }
+        break;
+    case I_SUB:
+        if (!isLit(b, 0)) { return -1; }
+        break;
+    case I_DIV:
+        if (!isLit(b, 1)) { return -1; }
+        break;
+    default:
+        return -1;
+    }
+    return a->tag == OP_VAR ? a->content.vreg : -1;
+}
+
+// the vreg at the end of a chain of copies
+static int copySource(int* source, int v) {
+    int r = v;
+    while (source[r] != r) { r = source[r]; }
+    while (source[v] != r) {
+        int next = source[v];
+        source[v] = r;
+        v = next;
+    }
+    return r;
+}
+
+static void replaceOprand(Oprand* op, int* source) {
+    if (op->tag == OP_VAR) { op->content.vreg = copySource(source, op->content.vreg); }
+}
+
+void propagateCopies(CFG* cfg) {
+    int vregNum = cfg->func->vregNum, b, k, j;
+    bool* strict = findStrictVregs(cfg);
+    int* source = (int*)malloc((vregNum + 1) * sizeof(int));
+    for (k = 0; k < vregNum; k++) { source[k] = k; }
+    for (b = 0; b < cfg->blockNum; b++) {
+        const BasicBlock* block = &cfg->blocks[b];
+        if (block->rpo < 0) { continue; }
+        for (k = 0; k < block->instNum; k++) {
+            const Instruction* i = &block->insts[k];
+            int y = copiedVreg(i);
+            if (y < 0) { continue; }
+            int x = i->addrs[0].content.vreg;
+            if (strict[x] && strict[y]) { source[x] = y; }
+        }
+    }
+
+    for (b = 0; b < cfg->blockNum; b++) {
+        BasicBlock* block = &cfg->blocks[b];
+        if (block->rpo < 0) { continue; }
+        int kept = 0;
+        for (k = 0; k < block->instNum; k++) {
+            Instruction* i = &block->insts[k];
+            int d = instDef(i), slots[3], n;
+            if (d >= 0 && source[d] != d) { continue; }
+            if (i->tag == I_PHI) {
+                PhiArg* args = i->addrs[1].content.args;
+                for (j = 0; j < i->addrs[2].content.lit; j++) { replaceOprand(&args[j].value, source); }
+            }
+            else {
+                n = useSlots(i, slots);
+                for (j = 0; j < n; j++) { replaceOprand(&i->addrs[slots[j]], source); }
+            }
+            block->insts[kept++] = *i;
+        }
+        block->instNum = kept;
+    }
+    free(strict);
+    free(source);
+}
@@ -0,0 +1,14 @@
+#ifndef COPYPROP_H
+#define COPYPROP_H
+
+#include"cfg.h"
+
+/*
+ * the copy propagation on the SSA form
+ * for `x := y`, or `x := y + 0` and the like, the reads of x become reads of y and the copy is dropped,
+ * which is safe as y is never written again, and is defined before x is
+ * the vregs possibly read uninitialized are left alone, to keep that true
+ */
+void propagateCopies(CFG* cfg);
+
+#endif
@@ -0,0 +1,440 @@
+#include "dataflow.h"
+#include<assert.h>
+
+// the sets of all the blocks in one block of memory, which is kept after them for `freeBitsets`
+static Word** newBitsets(int num, int words) {
+    Word** res = (Word**)malloc((num + 1) * sizeof(Word*));
+    Word* storage = (Word*)calloc((size_t)num * words + 1, sizeof(Word));
+    int i;
+    for (i = 0; i < num; i++) { res[i] = storage + (size_t)i * words; }
+    res[num] = storage;
+    return res;
+}
+
+static void freeBitsets(Word** sets, int num) {
+    free(sets[num]);
+    free(sets);
+}
+
+Dataflow* newDataflow(const CFG* cfg, enum FlowDirection dir, enum FlowMeet meet, int bits) {
+    Dataflow* df = (Dataflow*)malloc(sizeof(Dataflow));
+    df->dir = dir;
+    df->meet = meet;
+    df->bits = bits;
+    df->words = BITSET_WORDS(bits);
+    df->gen = newBitsets(cfg->blockNum, df->words);
+    df->kill = newBitsets(cfg->blockNum, df->words);
+    df->in = newBitsets(cfg->blockNum, df->words);
+    df->out = newBitsets(cfg->blockNum, df->words);
+    return df;
+}
+
+void freeDataflow(const CFG* cfg, Dataflow* df) {
+    freeBitsets(df->gen, cfg->blockNum);
+    freeBitsets(df->kill, cfg->blockNum);
+    freeBitsets(df->in, cfg->blockNum);
+    freeBitsets(df->out, cfg->blockNum);
+    free(df);
+}
+
+/*
+ * a forward problem meets the outs of the predecessors into the in of a block,
+ * and a backward one the ins of the successors into the out
+ * the blocks are kept in the worklist by their positions in the visiting order,
+ * and each round takes all the pending ones in that order
+ */
+void solveDataflow(const CFG* cfg, Dataflow* df, const Word* boundary) {
+    bool forward = df->dir == DF_FORWARD;
+    int n = cfg->orderNum, words = df->words;
+    bool* pending = (bool*)malloc((n + 1) * sizeof(bool));
+    Word* result = newBitset(words);
+    int pos, k, remaining = n;
+
+    for (pos = 0; pos < n; pos++) {
+        int b = cfg->order[pos];
+        Word* set = forward ? df->out[b] : df->in[b];
+        if (df->meet == DF_INTERSECT) { bitsetFill(set, words, df->bits); }
+        else { bitsetClear(set, words); }
+        pending[pos] = true;
+    }
+    while (remaining > 0) {
+        for (pos = 0; pos < n; pos++) {
+            if (!pending[pos]) { continue; }
+            pending[pos] = false;
+            remaining--;
+            int b = cfg->order[forward ? pos : n - 1 - pos];
+            const BasicBlock* block = &cfg->blocks[b];
+            Word* from = forward ? df->in[b] : df->out[b];
+            Word* to = forward ? df->out[b] : df->in[b];
+            const int* others = forward ? block->preds : block->succs;
+            int otherNum = forward ? block->predNum : block->succNum;
+
+            // the meet, the edges from the unreachable blocks do not count
+            bool first = true;
+            for (k = 0; k < otherNum; k++) {
+                int o = others[k];
+                if (cfg->blocks[o].rpo < 0) { continue; }
+                const Word* set = forward ? df->out[o] : df->in[o];
+                if (first) { bitsetCopy(from, set, words); }
+                else if (df->meet == DF_INTERSECT) { bitsetIntersect(from, set, words); }
+                else { bitsetUnion(from, set, words); }
+                first = false;
+            }
+            if (first || (forward && b == 0)) {
+                if (boundary != NULL) { bitsetCopy(from, boundary, words); }
+                else { bitsetClear(from, words); }
+            }
+
+            // the transfer
+            bitsetCopy(result, from, words);
+            bitsetDiff(result, df->kill[b], words);
+            bitsetUnion(result, df->gen[b], words);
+            if (bitsetEqual(result, to, words)) { continue; }
+            bitsetCopy(to, result, words);
+
+            const int* deps = forward ? block->succs : block->preds;
+            int depNum = forward ? block->succNum : block->predNum;
+            for (k = 0; k < depNum; k++) {
+                int rpo = cfg->blocks[deps[k]].rpo;
+                if (rpo < 0) { continue; }
+                int p = forward ? rpo : n - 1 - rpo;
+                if (!pending[p]) {
+                    pending[p] = true;
+                    remaining++;
+                }
+            }
+        }
+    }
+    free(pending);
+    free(result);
+}
+
+NonLocals findNonLocals(const CFG* cfg) {
+    NonLocals nl;
+    int vregNum = cfg->func->vregNum;
+    nl.vregNum = vregNum;
+    int* writer = (int*)malloc((vregNum + 1) * sizeof(int));   // the last block writing each vreg
+    int pos, k, j, v;
+    nl.bitOf = (int*)malloc((vregNum + 1) * sizeof(int));
+    nl.vregOf = (int*)malloc((vregNum + 1) * sizeof(int));
+    for (v = 0; v < vregNum; v++) { writer[v] = nl.bitOf[v] = -1; }
+    for (pos = 0; pos < cfg->orderNum; pos++) {
+        int b = cfg->order[pos];
+        const BasicBlock* block = &cfg->blocks[b];
+        for (k = 0; k < block->instNum; k++) {
+            int uses[3];
+            int n = instUses(&block->insts[k], uses);
+            for (j = 0; j < n; j++) {
+                if (writer[uses[j]] != b) { nl.bitOf[uses[j]] = 0; }
+            }
+            int d = instDef(&block->insts[k]);
+            if (d >= 0) { writer[d] = b; }
+        }
+    }
+    nl.num = 0;
+    for (v = 0; v < vregNum; v++) {
+        if (nl.bitOf[v] < 0) { continue; }
+        nl.bitOf[v] = nl.num;
+        nl.vregOf[nl.num++] = v;
+    }
+    free(writer);
+    return nl;
+}
+
+void freeNonLocals(NonLocals* nl) {
+    free(nl->bitOf);
+    free(nl->vregOf);
+}
+
+void liveStep(Word* live, const Instruction* i) {
+    int uses[3];
+    int d = instDef(i), n = instUses(i, uses), k;
+    if (d >= 0) { bitClear(live, d); }
+    for (k = 0; k < n; k++) { bitSet(live, uses[k]); }
+}
+
+Liveness* analyzeLiveness(const CFG* cfg) {
+    Liveness* lv = (Liveness*)malloc(sizeof(Liveness));
+    lv->nl = findNonLocals(cfg);
+    const int* bitOf = lv->nl.bitOf;
+    Dataflow* df = newDataflow(cfg, DF_BACKWARD, DF_UNION, lv->nl.num);
+    int pos, k, j;
+    for (pos = 0; pos < cfg->orderNum; pos++) {
+        int b = cfg->order[pos];
+        const BasicBlock* block = &cfg->blocks[b];
+        // gen is what is read before being written, walking the block backward
+        for (k = block->instNum - 1; k >= 0; k--) {
+            int uses[3];
+            int d = instDef(&block->insts[k]), n = instUses(&block->insts[k], uses);
+            if (d >= 0 && bitOf[d] >= 0) {
+                bitSet(df->kill[b], bitOf[d]);
+                bitClear(df->gen[b], bitOf[d]);
+            }
+            for (j = 0; j < n; j++) {
+                if (bitOf[uses[j]] >= 0) { bitSet(df->gen[b], bitOf[uses[j]]); }
+            }
+        }
+    }
+    lv->df = df;
+    solveDataflow(cfg, df, NULL);
+    return lv;
+}
+
+void liveOut(const Liveness* lv, int block, Word* live) {
+    const Word* out = lv->df->out[block];
+    int w, k;
+    bitsetClear(live, BITSET_WORDS(lv->nl.vregNum));
+    for (w = 0; w < lv->df->words; w++) {
+        // the sets are sparse, most of the words are empty
+        if (out[w] == 0) { continue; }
+        for (k = w * WORD_BITS; k < (w + 1) * WORD_BITS && k < lv->nl.num; k++) {
+            if (bitTest(out, k)) { bitSet(live, lv->nl.vregOf[k]); }
+        }
+    }
+}
+
+void freeLiveness(const CFG* cfg, Liveness* lv) {
+    freeDataflow(cfg, lv->df);
+    freeNonLocals(&lv->nl);
+    free(lv);
+}
+
+// an array of lists in one block of memory, from the number of the elements of each list
+// the block is kept after the lists, for `freeLists`
+static int** newLists(int num, const int* counts) {
+    int** res = (int**)malloc((num + 1) * sizeof(int*));
+    int total = 0, i;
+    for (i = 0; i < num; i++) { total += counts[i]; }
+    int* storage = (int*)malloc((total + 1) * sizeof(int));
+    total = 0;
+    for (i = 0; i < num; i++) {
+        res[i] = storage + total;
+        total += counts[i];
+    }
+    res[num] = storage;
+    return res;
+}
+
+static void freeLists(int** lists, int num) {
+    free(lists[num]);
+    free(lists);
+}
+
+ReachingDefs* analyzeReachingDefs(const CFG* cfg) {
+    ReachingDefs* rd = (ReachingDefs*)malloc(sizeof(ReachingDefs));
+    rd->nl = findNonLocals(cfg);
+    const int* bitOf = rd->nl.bitOf;
+    int vregNum = cfg->func->vregNum;
+    int defNum = 0, b, k;
+    for (b = 0; b < cfg->blockNum; b++) {
+        const BasicBlock* block = &cfg->blocks[b];
+        for (k = 0; k < block->instNum; k++) {
+            int v = instDef(&block->insts[k]);
+            if (v >= 0 && bitOf[v] >= 0) { defNum++; }
+        }
+    }
+    rd->defNum = defNum;
+    rd->defBlock = (int*)malloc((defNum + 1) * sizeof(int));
+    rd->defIndex = (int*)malloc((defNum + 1) * sizeof(int));
+    rd->defVreg = (int*)malloc((defNum + 1) * sizeof(int));
+    rd->vregDefNum = (int*)calloc(vregNum + 1, sizeof(int));
+    defNum = 0;
+    for (b = 0; b < cfg->blockNum; b++) {
+        const BasicBlock* block = &cfg->blocks[b];
+        for (k = 0; k < block->instNum; k++) {
+            int v = instDef(&block->insts[k]);
+            if (v < 0 || bitOf[v] < 0) { continue; }
+            rd->defBlock[defNum] = b;
+            rd->defIndex[defNum] = k;
+            rd->defVreg[defNum] = v;
+            rd->vregDefNum[v]++;
+            defNum++;
+        }
+    }
+    rd->vregDefs = newLists(vregNum, rd->vregDefNum);
+    for (k = 0; k < vregNum; k++) { rd->vregDefNum[k] = 0; }
+    for (k = 0; k < defNum; k++) {
+        int v = rd->defVreg[k];
+        rd->vregDefs[v][rd->vregDefNum[v]++] = k;
+    }
+
+    Dataflow* df = newDataflow(cfg, DF_FORWARD, DF_UNION, defNum);
+    for (k = 0; k < defNum; k++) {
+        b = rd->defBlock[k];
+        if (cfg->blocks[b].rpo < 0) { continue; }
+        int v = rd->defVreg[k], j;
+        for (j = 0; j < rd->vregDefNum[v]; j++) { bitSet(df->kill[b], rd->vregDefs[v][j]); }
+        reachStep(rd, df->gen[b], k);
+    }
+    rd->df = df;
+    solveDataflow(cfg, df, NULL);
+    return rd;
+}
+
+void reachStep(const ReachingDefs* rd, Word* reach, int def) {
+    int v = rd->defVreg[def], j;
+    for (j = 0; j < rd->vregDefNum[v]; j++) { bitClear(reach, rd->vregDefs[v][j]); }
+    bitSet(reach, def);
+}
+
+void freeReachingDefs(const CFG* cfg, ReachingDefs* rd) {
+    freeDataflow(cfg, rd->df);
+    free(rd->defBlock);
+    free(rd->defIndex);
+    free(rd->defVreg);
+    freeLists(rd->vregDefs, cfg->func->vregNum);
+    free(rd->vregDefNum);
+    freeNonLocals(&rd->nl);
+    free(rd);
+}
+
+static bool isArith(enum InstKind tag) {
+    return tag == I_ADD || tag == I_SUB || tag == I_MUL || tag == I_DIV;
+}
+
+// the expressions worth tracking across the blocks
+static bool isGlobalExpr(const NonLocals* nl, const Instruction* i) {
+    int k;
+    if (!isArith(i->tag)) { return false; }
+    for (k = 1; k < 3; k++) {
+        if (i->addrs[k].tag == OP_VAR && nl->bitOf[i->addrs[k].content.vreg] < 0) { return false; }
+    }
+    return true;
+}
+
+static bool sameOprand(const Oprand* a, const Oprand* b) {
+    return a->tag == b->tag && a->content.lit == b->content.lit;
+}
+
+Expr makeExpr(const Instruction* i) {
+    Expr e;
+    e.tag = i->tag;
+    e.ops[0] = i->addrs[1];
+    e.ops[1] = i->addrs[2];
+    if (i->tag == I_ADD || i->tag == I_MUL) {
+        const Oprand* a = &e.ops[0];
+        const Oprand* b = &e.ops[1];
+        if (a->tag > b->tag || (a->tag == b->tag && a->content.lit > b->content.lit)) {
+            Oprand t = e.ops[0];
+            e.ops[0] = e.ops[1];
+            e.ops[1] = t;
+        }
+    }
+    return e;
+}
+
+unsigned hashExpr(const Expr* e) {
+    unsigned h = (unsigned)e->tag;
+    int k;
+    for (k = 0; k < 2; k++) {
+        h = h * 31 + (unsigned)e->ops[k].tag;
+        h = h * 1000003u + (unsigned)e->ops[k].content.lit;
+    }
+    return h ^ (h >> 15);
+}
+
+bool sameExpr(const Expr* a, const Expr* b) {
+    return a->tag == b->tag && sameOprand(&a->ops[0], &b->ops[0]) && sameOprand(&a->ops[1], &b->ops[1]);
+}
+
+// the slot of an expression in the table, either holding it or empty
+static int lookupExpr(const AvailableExprs* ae, const Expr* e) {
+    unsigned i = hashExpr(e) & (ae->tableSize - 1);
+    while (ae->table[i] >= 0) {
+        const Expr* x = &ae->exprs[ae->table[i]];
+        if (sameExpr(x, e)) { break; }
+        i = (i + 1) & (ae->tableSize - 1);
+    }
+    return (int)i;
+}
+
+int findExpr(const AvailableExprs* ae, const Instruction* i) {
+    if (!isGlobalExpr(&ae->nl, i)) { return -1; }
+    Expr e = makeExpr(i);
+    return ae->table[lookupExpr(ae, &e)];
+}
+
+void availStep(const AvailableExprs* ae, Word* avail, const Instruction* i) {
+    int e = findExpr(ae, i), d = instDef(i), j;
+    if (e >= 0) { bitSet(avail, e); }
+    // a new value of an oprand kills the expressions, even the one just computed, as in `i := i + 1`
+    if (d >= 0) {
+        for (j = 0; j < ae->vregExprNum[d]; j++) { bitClear(avail, ae->vregExprs[d][j]); }
+    }
+}
+
+AvailableExprs* analyzeAvailableExprs(const CFG* cfg) {
+    AvailableExprs* ae = (AvailableExprs*)malloc(sizeof(AvailableExprs));
+    ae->nl = findNonLocals(cfg);
+    int vregNum = cfg->func->vregNum;
+    int arithNum = 0, b, k, j;
+    for (b = 0; b < cfg->blockNum; b++) {
+        const BasicBlock* block = &cfg->blocks[b];
+        for (k = 0; k < block->instNum; k++) {
+            if (isGlobalExpr(&ae->nl, &block->insts[k])) { arithNum++; }
+        }
+    }
+    // the table is at most half full
+    ae->tableSize = 16;
+    while (ae->tableSize < arithNum * 2) { ae->tableSize *= 2; }
+    ae->table = (int*)malloc(ae->tableSize * sizeof(int));
+    for (k = 0; k < ae->tableSize; k++) { ae->table[k] = -1; }
+    ae->exprs = (Expr*)malloc((arithNum + 1) * sizeof(Expr));
+    ae->exprNum = 0;
+    ae->vregExprNum = (int*)calloc(vregNum + 1, sizeof(int));
+    for (b = 0; b < cfg->blockNum; b++) {
+        const BasicBlock* block = &cfg->blocks[b];
+        for (k = 0; k < block->instNum; k++) {
+            if (!isGlobalExpr(&ae->nl, &block->insts[k])) { continue; }
+            Expr e = makeExpr(&block->insts[k]);
+            int slot = lookupExpr(ae, &e);
+            if (ae->table[slot] >= 0) { continue; }
+            ae->table[slot] = ae->exprNum;
+            ae->exprs[ae->exprNum++] = e;
+            for (j = 0; j < 2; j++) {
+                // `a * a` is listed once under `a`
+                if (e.ops[j].tag == OP_VAR && !(j == 1 && sameOprand(&e.ops[0], &e.ops[1]))) {
+                    ae->vregExprNum[e.ops[j].content.vreg]++;
+                }
+            }
+        }
+    }
+    ae->vregExprs = newLists(vregNum, ae->vregExprNum);
+    for (k = 0; k < vregNum; k++) { ae->vregExprNum[k] = 0; }
+    for (k = 0; k < ae->exprNum; k++) {
+        const Expr* e = &ae->exprs[k];
+        for (j = 0; j < 2; j++) {
+            if (e->ops[j].tag == OP_VAR && !(j == 1 && sameOprand(&e->ops[0], &e->ops[1]))) {
+                int v = e->ops[j].content.vreg;
+                ae->vregExprs[v][ae->vregExprNum[v]++] = k;
+            }
+        }
+    }
+
+    Dataflow* df = newDataflow(cfg, DF_FORWARD, DF_INTERSECT, ae->exprNum);
+    for (b = 0; b < cfg->blockNum; b++) {
+        const BasicBlock* block = &cfg->blocks[b];
+        if (block->rpo < 0) { continue; }
+        for (k = 0; k < block->instNum; k++) {
+            int d = instDef(&block->insts[k]);
+            if (d >= 0) {
+                for (j = 0; j < ae->vregExprNum[d]; j++) { bitSet(df->kill[b], ae->vregExprs[d][j]); }
+            }
+            availStep(ae, df->gen[b], &block->insts[k]);
+        }
+    }
+    ae->df = df;
+    // nothing is available at the entry
+    solveDataflow(cfg, df, NULL);
+    return ae;
+}
+
+void freeAvailableExprs(const CFG* cfg, AvailableExprs* ae) {
+    freeDataflow(cfg, ae->df);
+    free(ae->exprs);
+    free(ae->table);
+    freeLists(ae->vregExprs, ae->nl.vregNum);
+    free(ae->vregExprNum);
+    freeNonLocals(&ae->nl);
+    free(ae);
+}
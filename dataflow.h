@@ -0,0 +1,113 @@
+#ifndef DATAFLOW_H
+#define DATAFLOW_H
+
+#include"cfg.h"
+#include"bitset.h"
+
+/*
+ * the dataflow analyses over the blocks of a CFG
+ * a problem gives the gen & kill sets of each block, whose transfer function is
+ * `gen | (x - kill)`, and the solver iterates them to the fixed point
+ * with a worklist visited in reverse postorder, or its reverse for the backward problems
+ * the sets are dense bitsets on the heap, freed by `freeDataflow`
+ */
+enum FlowDirection { DF_FORWARD, DF_BACKWARD };
+enum FlowMeet { DF_UNION, DF_INTERSECT };
+
+typedef struct Dataflow {
+    enum FlowDirection dir;
+    enum FlowMeet meet;
+    int bits;           // the size of the universe
+    int words;
+    // indexed by the blocks, the unreachable ones are left empty
+    Word** gen;
+    Word** kill;
+    Word** in;
+    Word** out;
+} Dataflow;
+
+// the sets of a problem, all empty
+Dataflow* newDataflow(const CFG* cfg, enum FlowDirection dir, enum FlowMeet meet, int bits);
+// the in & out sets of the blocks, from the gen & kill sets
+// the entry (or the exits) starts with `boundary`, or the empty set for NULL
+void solveDataflow(const CFG* cfg, Dataflow* df, const Word* boundary);
+void freeDataflow(const CFG* cfg, Dataflow* df);
+
+/*
+ * most of the vregs are temporaries written & read in one block,
+ * the sets across the blocks are only over the non-locals, which are read in a block
+ * before any write there, numbered densely in their order
+ */
+typedef struct NonLocals {
+    int vregNum;        // all the vregs
+    int num;
+    int* bitOf;         // for each vreg, -1 for the locals
+    int* vregOf;
+} NonLocals;
+
+NonLocals findNonLocals(const CFG* cfg);
+void freeNonLocals(NonLocals* nl);
+
+// the non-local vregs live at the start & end of each block
+typedef struct Liveness {
+    Dataflow* df;
+    NonLocals nl;
+} Liveness;
+
+Liveness* analyzeLiveness(const CFG* cfg);
+// the vregs live at the end of a block, as a set of all the vregs
+void liveOut(const Liveness* lv, int block, Word* live);
+// step a set of all the vregs live backward over an instruction
+void liveStep(Word* live, const Instruction* i);
+void freeLiveness(const CFG* cfg, Liveness* lv);
+
+// the definitions of the non-local vregs, numbered in the order of the blocks
+typedef struct ReachingDefs {
+    Dataflow* df;
+    NonLocals nl;
+    int defNum;
+    int* defBlock;      // where each definition is
+    int* defIndex;
+    int* defVreg;       // what it defines
+    int** vregDefs;     // the definitions of each vreg
+    int* vregDefNum;
+} ReachingDefs;
+
+ReachingDefs* analyzeReachingDefs(const CFG* cfg);
+// step the reaching set forward over the definition `def`
+void reachStep(const ReachingDefs* rd, Word* reach, int def);
+void freeReachingDefs(const CFG* cfg, ReachingDefs* rd);
+
+// an arithmetic expression, the oprands of + & * in a canonical order
+typedef struct Expr {
+    enum InstKind tag;
+    Oprand ops[2];
+} Expr;
+
+// the expression computed by `addrs[1]` & `addrs[2]` of an instruction,
+// the oprands of the commutative ones are sorted, so `a + b` & `b + a` are the same
+Expr makeExpr(const Instruction* i);
+unsigned hashExpr(const Expr* e);
+bool sameExpr(const Expr* a, const Expr* b);
+
+// the expressions computed on every path and not changed since
+// only the ones on the non-local vregs & the literals, the others can not live across the blocks
+typedef struct AvailableExprs {
+    Dataflow* df;
+    NonLocals nl;
+    int exprNum;
+    Expr* exprs;
+    int* table;         // open addressing from the expressions to their numbers, -1 for the empty slots
+    int tableSize;
+    int** vregExprs;    // the expressions reading each vreg
+    int* vregExprNum;
+} AvailableExprs;
+
+AvailableExprs* analyzeAvailableExprs(const CFG* cfg);
+// step the available set forward over an instruction
+void availStep(const AvailableExprs* ae, Word* avail, const Instruction* i);
+// the number of the expression an instruction computes, -1 if it is not one
+int findExpr(const AvailableExprs* ae, const Instruction* i);
+void freeAvailableExprs(const CFG* cfg, AvailableExprs* ae);
+
+#endif
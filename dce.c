@@ -0,0 +1,113 @@
+#include "dce.h"
+#include<assert.h>
+#include<stdlib.h>
+
+// the instructions which do nothing but define their vreg
+static bool isPure(enum InstKind tag) {
+    switch (tag) {
+    case I_ASSGN: case I_COPY: case I_PHI:
+    case I_ADD: case I_SUB: case I_MUL: case I_DIV:
+    case I_ADDR: case I_LOAD:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void eliminateDeadCode(CFG* cfg) {
+    int vregNum = cfg->func->vregNum, n = cfg->blockNum, b, k, j;
+    // the instructions numbered from the start of each block
+    int* start = (int*)malloc((n + 1) * sizeof(int));
+    int total = 0;
+    for (b = 0; b < n; b++) {
+        start[b] = total;
+        if (cfg->blocks[b].rpo >= 0) { total += cfg->blocks[b].instNum; }
+    }
+    int* instBlock = (int*)malloc((total + 1) * sizeof(int));
+    // the definitions of each vreg, as lists in one block of memory
+    int* defNum = (int*)calloc(vregNum + 1, sizeof(int));
+    for (b = 0; b < n; b++) {
+        const BasicBlock* block = &cfg->blocks[b];
+        if (block->rpo < 0) { continue; }
+        for (k = 0; k < block->instNum; k++) {
+            int d = instDef(&block->insts[k]);
+            instBlock[start[b] + k] = b;
+            if (d >= 0) { defNum[d]++; }
+        }
+    }
+    int* defStart = (int*)malloc((vregNum + 2) * sizeof(int));
+    int* defs = (int*)malloc((total + 1) * sizeof(int));
+    int defTotal = 0;
+    for (k = 0; k < vregNum; k++) {
+        defStart[k] = defTotal;
+        defTotal += defNum[k];
+        defNum[k] = 0;
+    }
+    defStart[vregNum] = defTotal;
+    for (b = 0; b < n; b++) {
+        const BasicBlock* block = &cfg->blocks[b];
+        if (block->rpo < 0) { continue; }
+        for (k = 0; k < block->instNum; k++) {
+            int d = instDef(&block->insts[k]);
+            if (d >= 0) { defs[defStart[d] + defNum[d]++] = start[b] + k; }
+        }
+    }
+
+    // mark from the instructions with effects
+    bool* live = (bool*)calloc(total + 1, sizeof(bool));
+    int* work = (int*)malloc((total + 1) * sizeof(int));
+    int top = 0;
+    for (k = 0; k < total; k++) {
+        const BasicBlock* block = &cfg->blocks[instBlock[k]];
+        if (!isPure(block->insts[k - start[instBlock[k]]].tag)) {
+            live[k] = true;
+            work[top++] = k;
+        }
+    }
+    while (top > 0) {
+        int x = work[--top];
+        const Instruction* i = &cfg->blocks[instBlock[x]].insts[x - start[instBlock[x]]];
+        int uses[3], num = 0;
+        if (i->tag == I_PHI) {
+            const PhiArg* args = i->addrs[1].content.args;
+            for (j = 0; j < i->addrs[2].content.lit; j++) {
+                if (args[j].value.tag != OP_VAR) { continue; }
+                int v = args[j].value.content.vreg, d;
+                for (d = defStart[v]; d < defStart[v + 1]; d++) {
+                    if (!live[defs[d]]) {
+                        live[defs[d]] = true;
+                        work[top++] = defs[d];
+                    }
+                }
+            }
+            continue;
+        }
+        num = instUses(i, uses);
+        for (j = 0; j < num; j++) {
+            int d;
+            for (d = defStart[uses[j]]; d < defStart[uses[j] + 1]; d++) {
+                if (!live[defs[d]]) {
+                    live[defs[d]] = true;
+                    work[top++] = defs[d];
+                }
+            }
+        }
+    }
+
+    for (b = 0; b < n; b++) {
+        BasicBlock* block = &cfg->blocks[b];
+        if (block->rpo < 0) { continue; }
+        int kept = 0;
+        for (k = 0; k < block->instNum; k++) {
+            if (live[start[b] + k] || block->insts[k].tag == I_LABEL) { block->insts[kept++] = block->insts[k]; }
+        }
+        block->instNum = kept;
+    }
+    free(start);
+    free(instBlock);
+    free(defNum);
+    free(defStart);
+    free(defs);
+    free(live);
+    free(work);
+}
@@ -0,0 +1,13 @@
+#ifndef DCE_H
+#define DCE_H
+
+#include"cfg.h"
+
+/*
+ * the dead code elimination on the SSA form
+ * the instructions with effects are live, as are the definitions read by the live ones,
+ * and the other instructions are dropped, even those only reading each other around a loop
+ */
+void eliminateDeadCode(CFG* cfg);
+
+#endif
@@ -0,0 +1,137 @@
+#include "dom.h"
+#include<assert.h>
+#include<stdlib.h>
+
+// the nearest common dominator, walking up from the later one in the reverse postorder
+static int intersect(const CFG* cfg, const int* idom, int a, int b) {
+    while (a != b) {
+        while (cfg->blocks[a].rpo > cfg->blocks[b].rpo) { a = idom[a]; }
+        while (cfg->blocks[b].rpo > cfg->blocks[a].rpo) { b = idom[b]; }
+    }
+    return a;
+}
+
+static void addFrontier(Dominators* dom, int b, int join) {
+    int n = dom->frontierNum[b];
+    // the joins are added one by one, so a duplicate is always the last one
+    if (n > 0 && dom->frontier[b][n - 1] == join) { return; }
+    if (n == dom->frontierCap[b]) {
+        dom->frontierCap[b] = n == 0 ? 4 : n * 2;
+        dom->frontier[b] = (int*)realloc(dom->frontier[b], dom->frontierCap[b] * sizeof(int));
+    }
+    dom->frontier[b][dom->frontierNum[b]++] = join;
+}
+
+// number the blocks by a walk of the tree with an explicit stack, the tree can be as deep as the function is long
+static void numberTree(const CFG* cfg, Dominators* dom) {
+    int n = cfg->blockNum, time = 0;
+    int* stack = (int*)malloc((n + 1) * sizeof(int));
+    int* nextChild = (int*)calloc(n + 1, sizeof(int));
+    int top = 0;
+    stack[top++] = 0;
+    dom->pre[0] = time++;
+    while (top > 0) {
+        int b = stack[top - 1];
+        if (nextChild[b] < dom->childNum[b]) {
+            int c = dom->children[b][nextChild[b]++];
+            dom->pre[c] = time++;
+            stack[top++] = c;
+        }
+        else {
+            dom->post[b] = time++;
+            top--;
+        }
+    }
+    free(stack);
+    free(nextChild);
+}
+
+Dominators* computeDominators(const CFG* cfg) {
+    int n = cfg->blockNum, pos, k, b;
+    Dominators* dom = (Dominators*)malloc(sizeof(Dominators));
+    int* idom = (int*)malloc((n + 1) * sizeof(int));
+    for (b = 0; b < n; b++) { idom[b] = -1; }
+    idom[0] = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (pos = 1; pos < cfg->orderNum; pos++) {
+            b = cfg->order[pos];
+            const BasicBlock* block = &cfg->blocks[b];
+            int newIdom = -1;
+            for (k = 0; k < block->predNum; k++) {
+                int p = block->preds[k];
+                if (idom[p] < 0) { continue; }
+                newIdom = newIdom < 0 ? p : intersect(cfg, idom, p, newIdom);
+            }
+            if (newIdom != idom[b]) {
+                idom[b] = newIdom;
+                changed = true;
+            }
+        }
+    }
+    dom->idom = idom;
+
+    // the children, as lists in one block of memory
+    dom->childNum = (int*)calloc(n + 1, sizeof(int));
+    for (b = 1; b < n; b++) {
+        if (idom[b] >= 0) { dom->childNum[idom[b]]++; }
+    }
+    dom->children = (int**)malloc((n + 1) * sizeof(int*));
+    int* storage = (int*)malloc((n + 1) * sizeof(int));
+    int total = 0;
+    for (b = 0; b < n; b++) {
+        dom->children[b] = storage + total;
+        total += dom->childNum[b];
+        dom->childNum[b] = 0;
+    }
+    dom->children[n] = storage;
+    // in the reverse postorder, so a walk of the tree visits the blocks in a stable order
+    for (pos = 1; pos < cfg->orderNum; pos++) {
+        b = cfg->order[pos];
+        dom->children[idom[b]][dom->childNum[idom[b]]++] = b;
+    }
+    dom->pre = (int*)malloc((n + 1) * sizeof(int));
+    dom->post = (int*)malloc((n + 1) * sizeof(int));
+    for (b = 0; b < n; b++) { dom->pre[b] = dom->post[b] = -1; }
+    numberTree(cfg, dom);
+
+    // a join is in the frontiers of the blocks from each predecessor up to its immediate dominator
+    dom->frontier = (int**)calloc(n + 1, sizeof(int*));
+    dom->frontierNum = (int*)calloc(n + 1, sizeof(int));
+    dom->frontierCap = (int*)calloc(n + 1, sizeof(int));
+    for (pos = 0; pos < cfg->orderNum; pos++) {
+        b = cfg->order[pos];
+        const BasicBlock* block = &cfg->blocks[b];
+        if (block->predNum < 2) { continue; }
+        for (k = 0; k < block->predNum; k++) {
+            int runner = block->preds[k];
+            if (idom[runner] < 0) { continue; }
+            while (runner != idom[b]) {
+                addFrontier(dom, runner, b);
+                runner = idom[runner];
+            }
+        }
+    }
+    return dom;
+}
+
+bool dominates(const Dominators* dom, int a, int b) {
+    if (dom->pre[a] < 0 || dom->pre[b] < 0) { return false; }
+    return dom->pre[a] <= dom->pre[b] && dom->post[b] <= dom->post[a];
+}
+
+void freeDominators(const CFG* cfg, Dominators* dom) {
+    int b;
+    free(dom->idom);
+    free(dom->children[cfg->blockNum]);
+    free(dom->children);
+    free(dom->childNum);
+    free(dom->pre);
+    free(dom->post);
+    for (b = 0; b < cfg->blockNum; b++) { free(dom->frontier[b]); }
+    free(dom->frontier);
+    free(dom->frontierNum);
+    free(dom->frontierCap);
+    free(dom);
+}
@@ -0,0 +1,27 @@
+#ifndef DOM_H
+#define DOM_H
+
+#include"cfg.h"
+
+/*
+ * the dominator tree of the reachable blocks, and their dominance frontiers
+ * the immediate dominators are found by the iterative algorithm of Cooper, Harvey & Kennedy,
+ * which walks the reverse postorder until nothing changes
+ */
+typedef struct Dominators {
+    int* idom;          // the immediate dominator of each block, the entry is its own, -1 for the unreachable
+    int** children;     // the dominator tree
+    int* childNum;
+    int* pre;           // the visiting & leaving times of a walk of the tree, for `dominates`
+    int* post;
+    int** frontier;     // the dominance frontier of each block
+    int* frontierNum;
+    int* frontierCap;
+} Dominators;
+
+Dominators* computeDominators(const CFG* cfg);
+// whether every path from the entry to `b` goes through `a`, each block dominates itself
+bool dominates(const Dominators* dom, int a, int b);
+void freeDominators(const CFG* cfg, Dominators* dom);
+
+#endif
@@ -1,15 +1,50 @@
 #include "ir.h"
 #include "parser.h"
 #include "semantics.h"
+#include "report.h"
 #include<stdio.h>
 #include<assert.h>
 #include<string.h>
+#include<limits.h>
 
-#define GET_OP(instp, i) ((instp)->addrs[i])
+#define GET_OP(instp, i) (&(instp)->addrs[i])
 
-CONS(Oprand, makeLabelOp, OP_LABEL, char*, label)
-CONS(Oprand, makeVarOp, OP_VAR, char*, name)
-CONS(Oprand, makeLitOp, OP_LIT, int, lit)
+Oprand makeLabelOp(int label) {
+    Oprand res = { OP_LABEL };
+    res.content.label = label;
+    return res;
+}
+
+Oprand makeLitOp(int lit) {
+    Oprand res = { OP_LIT };
+    res.content.lit = lit;
+    return res;
+}
+
+Oprand makeVarOp(int vreg) {
+    Oprand res = { OP_VAR };
+    res.content.vreg = vreg;
+    return res;
+}
+
+Oprand makeFuncOp(Atom func) {
+    Oprand res = { OP_FUNC };
+    res.content.func = func;
+    return res;
+}
+
+Oprand makePhiOp(PhiArg* args) {
+    Oprand res = { OP_PHI };
+    res.content.args = args;
+    return res;
+}
+
+// the result of a translation which is already in its place
+Oprand makeNoneOp() {
+    Oprand res = { OP_NONE };
+    res.content.lit = 0;
+    return res;
+}
 
 enum InstKind getRelOp(enum RelOpTag tag) {
     switch (tag) {
@@ -23,200 +58,343 @@ enum InstKind getRelOp(enum RelOpTag tag) {
     }
 }
 
-bool isRVal(Oprand* op) {
-    return op->tag == OP_LIT || op->tag == OP_VAR;
+bool isCondGoto(enum InstKind tag) {
+    return tag >= I_EQGOTO && tag <= I_GEGOTO;
 }
 
-bool isLVal(Oprand* op) {
-    return op->tag == OP_VAR;
+enum InstKind negateGoto(enum InstKind tag) {
+    switch (tag) {
+    case I_EQGOTO: return I_NEGOTO;
+    case I_NEGOTO: return I_EQGOTO;
+    case I_LTGOTO: return I_GEGOTO;
+    case I_GEGOTO: return I_LTGOTO;
+    case I_GTGOTO: return I_LEGOTO;
+    case I_LEGOTO: return I_GTGOTO;
+    default: assert(0);
+    }
+}
+
+int instDef(const Instruction* i) {
+    switch (i->tag) {
+    case I_ASSGN: case I_COPY: case I_PHI: case I_ADD: case I_SUB: case I_MUL: case I_DIV:
+    case I_ADDR: case I_LOAD: case I_CALL: case I_READ: case I_PARAM: case I_DEC:
+        return i->addrs[0].content.vreg;
+    default:
+        return -1;
+    }
+}
+
+// the array of I_ADDR is counted as read, so its DEC stays alive as long as the address is taken
+// the args of I_PHI are read on the edges, not by the instruction
+int useSlots(const Instruction* i, int slots[3]) {
+    int n = 0, k, from;
+    switch (i->tag) {
+    case I_ASSGN: case I_COPY: case I_ADD: case I_SUB: case I_MUL: case I_DIV:
+    case I_ADDR: case I_LOAD:
+        from = 1; break;
+    case I_SAVE: case I_ARG: case I_RET: case I_WRITE:
+    case I_EQGOTO: case I_NEGOTO: case I_LTGOTO: case I_GTGOTO: case I_LEGOTO: case I_GEGOTO:
+        from = 0; break;
+    default:
+        return 0;
+    }
+    for (k = from; k < 3; k++) {
+        if (i->addrs[k].tag == OP_VAR) { slots[n++] = k; }
+    }
+    return n;
+}
+
+int instUses(const Instruction* i, int uses[3]) {
+    int n = useSlots(i, uses), k;
+    for (k = 0; k < n; k++) { uses[k] = i->addrs[uses[k]].content.vreg; }
+    return n;
+}
+
+bool isRVal(Oprand op) {
+    return op.tag == OP_LIT || op.tag == OP_VAR;
+}
+
+bool isLVal(Oprand op) {
+    return op.tag == OP_VAR;
 }
 
 // safe constructors
-Instruction* makeUnaryInst(enum InstKind tag, Oprand* op) {
+Instruction makeUnaryInst(enum InstKind tag, Oprand op) {
     switch (tag) {
-    case I_LABEL: case I_FUNC: case I_GOTO:
-        assert(op->tag == OP_LABEL); break;
+    case I_LABEL: case I_GOTO:
+        assert(op.tag == OP_LABEL); break;
+    case I_FUNC: assert(op.tag == OP_FUNC); break;
     case I_RET: case I_PARAM: case I_READ: case I_WRITE:
         assert(isRVal(op)); break;
     default: assert(0);
     }
-    NEW(Instruction, res);
-    res->tag = tag;
-    res->addrs[0] = op;
+    Instruction res;
+    res.tag = tag;
+    res.addrs[0] = op;
+    res.addrs[1] = res.addrs[2] = makeNoneOp();
     return res;
 }
 
 // I_ARG is designed to be binary, the second op is a lit i
 // shows it is the i'th arg
-Instruction* makeBinaryInst(enum InstKind tag, Oprand* op1, Oprand* op2) {
+Instruction makeBinaryInst(enum InstKind tag, Oprand op1, Oprand op2) {
     switch (tag) {
-    case I_ASSGN: assert(isLVal(op1) && isRVal(op2)); break;
+    case I_ASSGN: case I_COPY: assert(isLVal(op1) && isRVal(op2)); break;
     case I_ADDR: assert(isLVal(op1) && isLVal(op2)); break;
-    case I_LOAD: assert(isLVal(op1) && isRVal(op2)); break;
-    case I_SAVE: assert(isRVal(op1) && isRVal(op2)); break;
-    case I_ARG: assert(isRVal(op1) && op2->tag == OP_LIT); break;
+    case I_ARG: assert(isRVal(op1) && op2.tag == OP_LIT); break;
     case I_DEC:
-        assert(op1->tag == OP_VAR);
-        assert(op2->tag == OP_LIT && op2->content.lit % 4 == 0);
+        assert(op1.tag == OP_VAR);
+        assert(op2.tag == OP_LIT && op2.content.lit % 4 == 0);
         break;
     case I_CALL:
         assert(isLVal(op1));
-        assert(op2->tag == OP_LABEL);
+        assert(op2.tag == OP_FUNC);
         break;
     default: assert(0);
     }
 
-    NEW(Instruction, res);
-    res->tag = tag;
-    res->addrs[0] = op1;
-    res->addrs[1] = op2;
+    Instruction res;
+    res.tag = tag;
+    res.addrs[0] = op1;
+    res.addrs[1] = op2;
+    res.addrs[2] = makeNoneOp();
     return res;
 }
 
-Instruction* makeTernaryInst(enum InstKind tag, Oprand* op1, Oprand* op2, Oprand* op3) {
+Instruction makeTernaryInst(enum InstKind tag, Oprand op1, Oprand op2, Oprand op3) {
     switch (tag) {
     case I_ADD: case I_SUB: case I_MUL: case I_DIV:
         assert(isLVal(op1) && isRVal(op2) && isRVal(op3)); break;
     case I_EQGOTO: case I_NEGOTO: case I_LTGOTO: case I_GTGOTO: case I_LEGOTO: case I_GEGOTO:
-        assert(isRVal(op1) && isRVal(op2) && op3->tag == OP_LABEL); break;
+        assert(isRVal(op1) && isRVal(op2) && op3.tag == OP_LABEL); break;
+    // the memory accesses take a constant offset to the address
+    case I_LOAD: assert(isLVal(op1) && isRVal(op2) && op3.tag == OP_LIT); break;
+    case I_PHI: assert(isLVal(op1) && op2.tag == OP_PHI && op3.tag == OP_LIT); break;
+    case I_SAVE: assert(isRVal(op1) && isRVal(op2) && op3.tag == OP_LIT); break;
     default: assert(0);
     }
-    NEW(Instruction, res);
-    res->tag = tag;
-    res->addrs[0] = op1;
-    res->addrs[1] = op2;
-    res->addrs[2] = op3;
+    Instruction res;
+    res.tag = tag;
+    res.addrs[0] = op1;
+    res.addrs[1] = op2;
+    res.addrs[2] = op3;
     return res;
 }
 
-void printOprand(FILE* out, const Oprand* op) {
+// the user variables are printed by their names, the temporaries by their numbers
+void printOprand(FILE* out, const IRFunction* func, const Oprand* op) {
     switch (op->tag) {
-    case OP_LABEL: fprintf(out, "%s", op->content.label); break;
+    case OP_LABEL: fprintf(out, "label%X", func->labelBase + op->content.label); break;
+    case OP_FUNC: fprintf(out, "%s", op->content.func); break;
     case OP_LIT: fprintf(out, "#%d", op->content.lit); break;
-    case OP_VAR: fprintf(out, "%s", op->content.name); break;
+    case OP_VAR:
+        if (op->content.vreg < func->localNum) { fprintf(out, "%s", func->localNames[op->content.vreg]); }
+        else { fprintf(out, "t$%X", op->content.vreg - func->localNum); }
+        break;
     default: assert(0);
     }
 }
 
-void printStrOp1(FILE* out, const Instruction* i, const char* str) {
+void printStrOp1(FILE* out, const IRFunction* func, const Instruction* i, const char* str) {
     fprintf(out, str);
-    printOprand(out, GET_OP(i, 0));
+    printOprand(out, func, GET_OP(i, 0));
 }
 
-void printOp1StrOp2(FILE* out, const Instruction* i, const char* str) {
-    printOprand(out, GET_OP(i, 0));
+void printOp1StrOp2(FILE* out, const IRFunction* func, const Instruction* i, const char* str) {
+    printOprand(out, func, GET_OP(i, 0));
     fprintf(out, str);
-    printOprand(out, GET_OP(i, 1));
+    printOprand(out, func, GET_OP(i, 1));
 }
 
-void printArith(FILE* out, const Instruction* i, const char* op) {
-    printOp1StrOp2(out, i, " := ");
+void printArith(FILE* out, const IRFunction* func, const Instruction* i, const char* op) {
+    printOp1StrOp2(out, func, i, " := ");
     fprintf(out, op);
-    printOprand(out, GET_OP(i, 2));
+    printOprand(out, func, GET_OP(i, 2));
 }
 
-void printRelGoto(FILE* out, const Instruction* i, const char* op) {
+void printRelGoto(FILE* out, const IRFunction* func, const Instruction* i, const char* op) {
     fprintf(out, "IF ");
-    printOp1StrOp2(out, i, op);
+    printOp1StrOp2(out, func, i, op);
     fprintf(out, " GOTO ");
-    printOprand(out, GET_OP(i, 2));
+    printOprand(out, func, GET_OP(i, 2));
 }
 
-void printInst(FILE* out, const Instruction* i) {
+// `*x`, or `*(x + #k)` with an offset
+void printMem(FILE* out, const IRFunction* func, const Instruction* i, int addr) {
+    if (GET_OP(i, 2)->content.lit == 0) {
+        fprintf(out, "*");
+        printOprand(out, func, GET_OP(i, addr));
+        return;
+    }
+    fprintf(out, "*(");
+    printOprand(out, func, GET_OP(i, addr));
+    fprintf(out, " + ");
+    printOprand(out, func, GET_OP(i, 2));
+    fprintf(out, ")");
+}
+
+void printInst(FILE* out, const IRFunction* func, const Instruction* i) {
     switch (i->tag) {
-    case I_LABEL: printStrOp1(out, i, "LABEL "); fprintf(out, " :"); break;
-    case I_FUNC: printStrOp1(out, i, "FUNCTION "); fprintf(out, " :"); break;
-    case I_ASSGN: printOp1StrOp2(out, i, " := "); break;
-    case I_ADD: printArith(out, i, " + "); break;
-    case I_SUB: printArith(out, i, " - "); break;
-    case I_MUL: printArith(out, i, " * "); break;
-    case I_DIV: printArith(out, i, " / "); break;
-    case I_ADDR: printOp1StrOp2(out, i, " := &"); break;
-    case I_LOAD: printOp1StrOp2(out, i, " := *"); break;
-    case I_SAVE: fprintf(out, "*"); printOp1StrOp2(out, i, " := "); break;
-    case I_GOTO: printStrOp1(out, i, "GOTO "); break;
-    case I_EQGOTO: printRelGoto(out, i, " == "); break;
-    case I_NEGOTO: printRelGoto(out, i, " != "); break;
-    case I_LTGOTO: printRelGoto(out, i, " < "); break;
-    case I_GTGOTO: printRelGoto(out, i, " > "); break;
-    case I_LEGOTO: printRelGoto(out, i, " <= "); break;
-    case I_GEGOTO: printRelGoto(out, i, " >= "); break;
-    case I_RET: printStrOp1(out, i, "RETURN "); break;
+    case I_LABEL: printStrOp1(out, func, i, "LABEL "); fprintf(out, " :"); break;
+    case I_FUNC: printStrOp1(out, func, i, "FUNCTION "); fprintf(out, " :"); break;
+    case I_ASSGN: printOp1StrOp2(out, func, i, " := "); break;
+    case I_ADD: printArith(out, func, i, " + "); break;
+    case I_SUB: printArith(out, func, i, " - "); break;
+    case I_MUL: printArith(out, func, i, " * "); break;
+    case I_DIV: printArith(out, func, i, " / "); break;
+    case I_ADDR: printOp1StrOp2(out, func, i, " := &"); break;
+    case I_LOAD:
+        printOprand(out, func, GET_OP(i, 0));
+        fprintf(out, " := ");
+        printMem(out, func, i, 1);
+        break;
+    case I_SAVE:
+        printMem(out, func, i, 0);
+        fprintf(out, " := ");
+        printOprand(out, func, GET_OP(i, 1));
+        break;
+    case I_GOTO: printStrOp1(out, func, i, "GOTO "); break;
+    case I_EQGOTO: printRelGoto(out, func, i, " == "); break;
+    case I_NEGOTO: printRelGoto(out, func, i, " != "); break;
+    case I_LTGOTO: printRelGoto(out, func, i, " < "); break;
+    case I_GTGOTO: printRelGoto(out, func, i, " > "); break;
+    case I_LEGOTO: printRelGoto(out, func, i, " <= "); break;
+    case I_GEGOTO: printRelGoto(out, func, i, " >= "); break;
+    case I_RET: printStrOp1(out, func, i, "RETURN "); break;
     case I_DEC:
-        printStrOp1(out, i, "DEC ");
+        printStrOp1(out, func, i, "DEC ");
         fprintf(out, " %d ", GET_OP(i, 1)->content.lit);
         break;
     case I_ARG: 
-        printStrOp1(out, i, "ARG "); 
-        fprintf(out, ", no %d", i->addrs[1]->content.lit);
+        printStrOp1(out, func, i, "ARG "); 
+        fprintf(out, ", no %d", GET_OP(i, 1)->content.lit);
+        break;
+    case I_CALL: printOp1StrOp2(out, func, i, " := CALL "); break;
+    case I_PARAM: printStrOp1(out, func, i, "PARAM "); break;
+    case I_READ: printStrOp1(out, func, i, "READ "); break;
+    case I_WRITE: printStrOp1(out, func, i, "WRITE "); break;
+    case I_PHI:
+    {
+        int k;
+        printOprand(out, func, GET_OP(i, 0));
+        fprintf(out, " := PHI(");
+        for (k = 0; k < GET_OP(i, 2)->content.lit; k++) {
+            if (k != 0) { fprintf(out, ", "); }
+            printOprand(out, func, &GET_OP(i, 1)->content.args[k].value);
+        }
+        fprintf(out, ")");
         break;
-    case I_CALL: printOp1StrOp2(out, i, " := CALL "); break;
-    case I_PARAM: printStrOp1(out, i, "PARAM "); break;
-    case I_READ: printStrOp1(out, i, "READ "); break;
-    case I_WRITE: printStrOp1(out, i, "WRITE "); break;
+    }
+    case I_COPY: printOp1StrOp2(out, func, i, " := "); break;
     default:assert(0);
     }
 }
 
 void printIR(FILE* out, const IR* ir) {
-    IRNode* i;
-    // skip the first dummy node
-    for (i = ir->head->next; i != NULL; i = i->next) {
-        printInst(out, i->inst);
-        fprintf(out, "\n");
+    int f, i;
+    for (f = 0; f < ir->funcNum; f++) {
+        const IRFunction* func = &ir->funcs[f];
+        for (i = 0; i < func->instNum; i++) {
+            printInst(out, func, &func->insts[i]);
+            fprintf(out, "\n");
+        }
     }
 }
 
-IRNode* makeIRNode(const Instruction* inst) {
-    NEW(IRNode, res);
-    res->inst = inst;
-    res->next = NULL;
-    return res;
+long countInsts(const IR* ir) {
+    long n = 0;
+    int f;
+    for (f = 0; f < ir->funcNum; f++) { n += ir->funcs[f].instNum; }
+    return n;
 }
 
 IR* makeIR() {
     NEW(IR, res);
-    NEW(IRNode, dummy);
-    res->head = res->tail = dummy;
+    res->labelNum = 0;
+    res->funcs = NULL;
+    res->funcNum = res->funcCap = 0;
     return res;
 }
 
-// write an instruction to the target ir
-void writeInst(IR* target, const Instruction* inst) {
-    target->tail->next = makeIRNode(inst);
-    target->tail = target->tail->next;
+// make room for one more element in an array of the arena, by doubling it when it is full
+void* reserveSlot(void* array, int num, int* cap, size_t elemSize) {
+    if (num < *cap) { return array; }
+    *cap = *cap == 0 ? 16 : *cap * 2;
+    void* res = arenaAlloc(currentArena, *cap * elemSize);
+    if (num != 0) { memcpy(res, array, num * elemSize); }
+    return res;
 }
 
-void insertInst(IR* target, IRNode* node, const Instruction* inst) {
-    IRNode* p = node->next;
-    node->next = makeIRNode(inst);
-    node->next->next = p;
-    if (target->tail == node) {
-        target->tail = node->next;
-    }
+// start a new function, the following instructions are written to it
+// the parameters & local variables take the first vregs, as numbered by the semantic analysis
+static void beginFunction(IR* target, Atom name, const FunctionEntry* def) {
+    target->funcs = (IRFunction*)reserveSlot(target->funcs, target->funcNum, &target->funcCap, sizeof(IRFunction));
+    IRFunction* func = &target->funcs[target->funcNum++];
+    func->insts = NULL;
+    func->instNum = func->instCap = 0;
+    func->name = name;
+    func->localNum = func->vregNum = def->localNum;
+    func->localNames = (Atom*)arenaAlloc(currentArena, (def->localNum + 1) * sizeof(Atom));
+    func->labelNum = 0;
+    func->labelBase = target->labelNum;
+}
+
+static IRFunction* currentFunction(IR* target) {
+    assert(target->funcNum > 0);
+    return &target->funcs[target->funcNum - 1];
+}
+
+// write an instruction to the current function of the target ir
+void writeInst(IR* target, Instruction inst) {
+    IRFunction* func = currentFunction(target);
+    func->insts = (Instruction*)reserveSlot(func->insts, func->instNum, &func->instCap, sizeof(Instruction));
+    func->insts[func->instNum++] = inst;
 }
 
 /* yield a fresh temp variable */
-Oprand* newTempVar() {
-    static int no = 0;
-    char* res = (char*)malloc(NAME_SIZE);
-    sprintf(res, "t$%X", no);
-    no++;
-    return makeVarOp(res);
+Oprand newTempVar(IR* target) {
+    return makeVarOp(currentFunction(target)->vregNum++);
 }
 
 /* yield a fresh label */
-Oprand* newLabel() {
-    static int no = 0;
-    char* res = (char*)malloc(NAME_SIZE);
-    sprintf(res, "label%X", no);
-    no++;
-    return makeLabelOp(res);
+Oprand newLabel(IR* target) {
+    target->labelNum++;
+    return makeLabelOp(currentFunction(target)->labelNum++);
+}
+
+int newFuncVreg(IRFunction* func) {
+    return func->vregNum++;
+}
+
+int newFuncLabel(IRFunction* func) {
+    return func->labelNum++;
+}
+
+void renumberLabels(IR* ir) {
+    int f;
+    ir->labelNum = 0;
+    for (f = 0; f < ir->funcNum; f++) {
+        ir->funcs[f].labelBase = ir->labelNum;
+        ir->labelNum += ir->funcs[f].labelNum;
+    }
+}
+
+// the oprand of a user variable, resolved by the semantic analysis
+Oprand makeLocalOp(IR* target, const SymbolTableEntry* e) {
+    IRFunction* func = currentFunction(target);
+    assert(e != NULL && e->tag == S_VAR && e->local >= 0 && e->local < func->localNum);
+    func->localNames[e->local] = e->content.varDef->name;
+    return makeVarOp(e->local);
 }
 
-void translateProgram(IR* target, Node* root, SymbolTable table) {
+// an unsupported feature abandons the whole program, and jumps back here
+#define UNSUPPORTED(target) longjmp((target)->unsupported, 1)
+
+bool translateProgram(IR* target, Node* root, SymbolTable table) {
     assert(root->tag == Program);
+    if (setjmp(target->unsupported) != 0) { return false; }
     translateExtDefList(target, GET_CHILD(root, 0), table);
+    return true;
 }
 
 void translateExtDefList(IR* target, Node* root, SymbolTable table) {
@@ -228,52 +406,46 @@ void translateExtDefList(IR* target, Node* root, SymbolTable table) {
 
 void translateExtDef(IR* target, Node* root, SymbolTable table) {
     assert(root->tag == ExtDef);
-    if (PATTERN3(root, Specifier, ExtDecList, _)) { // ExtDef -> Specifier ExtDecList SEMI
-        // no global variables, as guaranteed
-        printf("global variables are not supported\n");
-        exit(0);
-    }
-    else if (PATTERN2(root, Specifier, _)) { // ExtDef -> Specifier SEMI
+    switch (GET_PROD(root)) {
+    case P_EXT_DEF_VAR:     // ExtDef -> Specifier ExtDecList SEMI
         // no global variables, as guaranteed
         printf("global variables are not supported\n");
-        exit(0);
-    }
-    else if (PATTERN3(root, Specifier, FunDec, CompSt)) { // function definition
+        UNSUPPORTED(target);
+    case P_EXT_DEF_TYPE:    // ExtDef -> Specifier SEMI
+        // a structure definition, whose layout is already known
+        break;
+    case P_EXT_DEF_FUNC:    // function definition
+    {
         Node* funDec = GET_CHILD(root, 1);
-        char* fname = GET_TERMINAL(GET_CHILD(funDec, 0), reprS);
-        writeInst(target, makeUnaryInst(I_FUNC, makeLabelOp(fname)));
-        translateFuncParam(target, funDec, table);
+        Atom fname = GET_NAME(GET_CHILD(funDec, 0));
+        beginSpan(fname);
+        beginFunction(target, fname, GET_ENTRY(GET_CHILD(funDec, 0))->content.funcDef);
+        writeInst(target, makeUnaryInst(I_FUNC, makeFuncOp(fname)));
+        translateFuncParam(target, funDec);
         translateCompSt(target, GET_CHILD(root, 2), table);
+        endSpan();
+        break;
     }
-    else if (PATTERN3(root, Specifier, FunDec, TOKEN)) { // function declaration 
+    case P_EXT_DEF_DECL:    // function declaration
         printf("function declaration is not available");
-        exit(0);
+        UNSUPPORTED(target);
+    default: assert(0);
     }
 }
 
 // quite special one, for function parameter preparation
-void translateFuncParam(IR* target, Node* root, SymbolTable table) {
+// the parameters are bound to their entries, in the order of the declaration
+void translateFuncParam(IR* target, Node* root) {
     assert(root->tag == FunDec);
-    if (PATTERN4(root, TOKEN, _, VarList, _)) {
-        // the signature information can be obtained from the table
-        char* fname = GET_TERMINAL(GET_CHILD(root, 0), reprS);
-        SymbolTableNode* p;
-        FuncSignature* fs = NULL;
-        for (p = table; p != NULL; p = p->next) {
-            if (p->content->tag == S_FUNC &&
-                strcmp(p->content->content.funcDef->name, fname) == 0) {
-                assert(p->content->content.funcDef->type->tag == FUNC);
-                fs = p->content->content.funcDef->type->content.func;
-                break;
-            }
-        }
-        assert(fs != NULL);
-        RecordField* q;
-        for (q = fs->params; q != NULL; q = q->next) {
-            writeInst(target, makeUnaryInst(I_PARAM, makeVarOp(q->name)));
+    if (GET_PROD(root) == P_FUN_DEC_PARAMS) {
+        Node* varList;
+        for (varList = GET_CHILD(root, 1); varList != NULL;
+            varList = GET_PROD(varList) == P_VAR_LIST_CONS ? GET_CHILD(varList, 1) : NULL) {
+            Node* varDec = GET_CHILD(GET_CHILD(varList, 0), 1);
+            writeInst(target, makeUnaryInst(I_PARAM, makeLocalOp(target, GET_ENTRY(getVarDecID(varDec)))));
         }
     }
-    else if (PATTERN3(root, TOKEN, _, _)) {
+    else {
         // nothing to do here
     }
 }
@@ -281,526 +453,515 @@ void translateFuncParam(IR* target, Node* root, SymbolTable table) {
 // generate code to `target` and return a list of temp variables of the args
 ArgList* translateArgs(IR* target, Node* root, SymbolTable table) {
     assert(root->tag == Args);
-    if (PATTERN(root, Exp)) {
+    switch (GET_PROD(root)) {
+    case P_ARGS:
+    {
         DO_TRANSLATE_EXP(target, GET_CHILD(root, 0), table, t1);
         NEW(ArgList, res);
         res->argVal = t1;
         res->next = NULL;
         return res;
     }
-    else if (PATTERN3(root, Exp, _, Args)) {
+    case P_ARGS_CONS:
+    {
         DO_TRANSLATE_EXP(target, GET_CHILD(root, 0), table, t1);
         NEW(ArgList, res);
         res->argVal = t1;
-        res->next = translateArgs(target, GET_CHILD(root, 2), table);
+        res->next = translateArgs(target, GET_CHILD(root, 1), table);
         return res;
     }
-    CATCH_ALL
+    default: assert(0);
+    }
 }
 
-// a helper function calculating the element size of an array type
-int getElemSize(Type* arrayT) {
+// the element size of an array type, from its layout
+// the target is abandoned if the elements can not be laid out
+int getElemSize(IR* target, Type* arrayT) {
     assert(arrayT->tag == ARRAY);
-    switch (arrayT->content.array->type->tag) {
-    case PRIMITIVE: return 4;
-    case ARRAY:
-    {
-        Type* elem = arrayT->content.array->type;
-        return getElemSize(elem) * elem->content.array->size;
-    }
-    case FUNC: case RECORD:
-        printf("function or struct as array elements is not supported\n");
-        exit(0);
-    default: assert(0);
+    if (arrayT->content.array->strides[0] < 0) {
+        printf("the array elements can not be laid out\n");
+        UNSUPPORTED(target);
     }
+    return arrayT->content.array->strides[0];
 }
 
-int getArraySize(Type* arrayT) {
-    return getElemSize(arrayT) * arrayT->content.array->size;
+// the size of an array or a structure, from its layout
+int getTypeSize(IR* target, Type* t) {
+    int size;
+    switch (t->tag) {
+    case PRIMITIVE: return 4;
+    case ARRAY: size = t->content.array->byteSize; break;
+    case RECORD: size = t->content.record->byteSize; break;
+    default: size = -1; break;
+    }
+    if (size < 0) {
+        printf("the type can not be laid out\n");
+        UNSUPPORTED(target);
+    }
+    return size;
 }
 
-// quite special one, only works for `Exp -> ID | Exp[Exp]`
-// generates code that calculates the **address** of the array exp
-// returns the remainder dimensions' type of the for the current continuation
-Type* translateArray(IR* target, Node* root, SymbolTable table, Oprand* place) {
+// quite special one, only works for `Exp -> ID | (Exp) | Exp[Exp] | Exp.ID`
+// generates code that calculates the **address** of an array, a structure or their members
+// the address is `*addr` plus `*offset`, since the constant indexes and all the fields
+// of the whole chain are folded into a single offset, which the loads & stores take directly
+void translateAddress(IR* target, Node* root, SymbolTable table, Oprand* addr, int* offset) {
     assert(root->tag == Exp);
-    // ID, the base case of the array expression structure
-    if (PATTERN(root, TOKEN)
-        && GET_CHILD(root, 0)->content.terminal->tag == ID) {
-        char* varName = GET_TERMINAL(GET_CHILD(root, 0), reprS);
-        // get the array base address
-        writeInst(target, makeBinaryInst(I_ASSGN, place, makeVarOp(varName)));
-        // lookup the table and return the type of the whole array
-        SymbolTableNode* p;
-        for (p = table; p != NULL; p = p->next) {
-            if (p->content->tag == S_VAR &&
-                strcmp(p->content->content.varDef->name, varName) == 0) {
-                return p->content->content.varDef->type;
-            }
+    switch (GET_PROD(root)) {
+    case P_EXP_ID:
+        // the variable of an array or a structure holds its address
+        *addr = makeLocalOp(target, GET_ENTRY(GET_CHILD(root, 0)));
+        return;
+    case P_EXP_PAREN:   // (Exp)
+        translateAddress(target, GET_CHILD(root, 0), table, addr, offset);
+        return;
+    case P_EXP_INDEX:   // Exp[Exp]
+    {
+        translateAddress(target, GET_CHILD(root, 0), table, addr, offset);
+        // the stride of the current dimension, from the layout of the array indexed
+        int stride = getElemSize(target, GET_TYPE(GET_CHILD(root, 0)));
+        DO_TRANSLATE_EXP(target, GET_CHILD(root, 1), table, index);
+        if (index.tag == OP_LIT) {
+            *offset += index.content.lit * stride;
+        }
+        else {
+            DO_TRANSLATE_ARITH(target, I_MUL, index, makeLitOp(stride), table, t1);
+            Oprand t2 = newTempVar(target);
+            doTranslateArith(target, *addr, t1, &t2, I_ADD);
+            *addr = t2;
         }
-        assert(0);
-    }
-    // recursive case, calculate the current dimension
-    else if (PATTERN4(root, Exp, _, Exp, _)) {  // Exp[Exp]
-        Oprand* t1 = newTempVar();
-        // first calculate the address of the previous dimensions
-        // save to $t1
-        Type* arrayType = translateArray(target, GET_CHILD(root, 0), table, t1);
-        // get the element size of the current dimension, just a static value
-        int size = getElemSize(arrayType);
-        // calculate the index, save to $t2
-        DO_TRANSLATE_EXP(target, GET_CHILD(root, 2), table, t2);
-        // multiply by the element size
-        DO_TRANSLATE_ARITH(target, I_MUL, t2, makeLitOp(size), table, t3);
-        // then add on the offset of the current dimension
-        doTranslateArith(target, t1, t3, place, I_ADD);
-        return arrayType->content.array->type;  // return the remainder type
+        return;
     }
-    else {
-        // there is no other way to form an array expression (?)
-        printf("unavailable array expression found.\n");
-        exit(0);
+    case P_EXP_FIELD:   // Exp.ID
+        translateAddress(target, GET_CHILD(root, 0), table, addr, offset);
+        *offset += GET_FIELD(GET_CHILD(root, 1))->offset;
+        return;
+    default:
+        // e.g. a structure returned by a function
+        printf("unavailable array or structure expression found.\n");
+        UNSUPPORTED(target);
     }
 }
 
-// a helper function to copy an array to another
+// a helper function to copy an array or a structure to another
 // the loop has been flattened, for a better performance
-void copyArray(IR* target, Oprand* dst, int dstSize, Oprand* src, int srcSize) {
+void copyMemory(IR* target, Oprand dst, int dstOffset, int dstSize, Oprand src, int srcOffset, int srcSize) {
     int i;
     int mi = dstSize > srcSize ? srcSize : dstSize;
-    Oprand* t = newTempVar();
-    for (i = 0; i < mi / 4; i++) {
-        // *dst = *src; dst += 4; src += 4;
-        writeInst(target, makeBinaryInst(I_LOAD, t, src));
-        writeInst(target, makeBinaryInst(I_SAVE, dst, t));
-        // since `dst` and `src` are variables, there's no need to perform const-folding
-        writeInst(target, makeTernaryInst(I_ADD, dst, dst, makeLitOp(4)));
-        writeInst(target, makeTernaryInst(I_ADD, src, src, makeLitOp(4)));
+    Oprand t = newTempVar(target);
+    for (i = 0; i < mi; i += 4) {
+        writeInst(target, makeTernaryInst(I_LOAD, t, src, makeLitOp(srcOffset + i)));
+        writeInst(target, makeTernaryInst(I_SAVE, dst, t, makeLitOp(dstOffset + i)));
     }
 }
 
-Oprand* foldConstant(Oprand* t1, Oprand* t2, enum InstKind tag) {
+// store `a tag b` to `res` and return true, or return false when it has no value, leaving `res` alone
+bool evalArith(enum InstKind tag, int a, int b, int* res) {
+    // the arithmetic wraps around as it does on the machine
+    switch (tag) {
+    case I_ADD: *res = (int)((unsigned)a + (unsigned)b); return true;
+    case I_SUB: *res = (int)((unsigned)a - (unsigned)b); return true;
+    case I_MUL: *res = (int)((unsigned)a * (unsigned)b); return true;
+    case I_DIV:
+        // the quotients of C99 are truncated toward 0, the same as `div`
+        if (b == 0 || (a == INT_MIN && b == -1)) { return false; }
+        *res = a / b;
+        return true;
+    default: assert(0);
+    }
+}
+
+bool evalCond(enum InstKind tag, int a, int b) {
+    switch (tag) {
+    case I_EQGOTO: return a == b;
+    case I_NEGOTO: return a != b;
+    case I_LTGOTO: return a < b;
+    case I_GTGOTO: return a > b;
+    case I_LEGOTO: return a <= b;
+    case I_GEGOTO: return a >= b;
+    default: assert(0);
+    }
+}
+
+// the folded literal, or OP_NONE when the oprands are not both literals or have no value
+Oprand foldConstant(Oprand t1, Oprand t2, enum InstKind tag) {
     assert(tag == I_ADD || tag == I_SUB || tag == I_MUL || tag == I_DIV);
-    if (t1->tag == OP_LIT && t2->tag == OP_LIT) {
-        // fold here
-        switch (tag) {
-        case I_ADD: return makeLitOp(t1->content.lit + t2->content.lit);
-        case I_SUB: return makeLitOp(t1->content.lit - t2->content.lit);
-        case I_MUL: return makeLitOp(t1->content.lit * t2->content.lit);
-        case I_DIV: return NULL;
-        default: assert(0);
-        }
+    int res;
+    if (t1.tag == OP_LIT && t2.tag == OP_LIT && evalArith(tag, t1.content.lit, t2.content.lit, &res)) {
+        return makeLitOp(res);
     }
+    return makeNoneOp();
 }
 
 // use this function to perform constant folding
 // op1 && op2 is lit, then return fold
-// otherwise, store to place if place != NULL, and return NULL
-Oprand* doTranslateArith(IR* target, Oprand* op1, Oprand* op2, Oprand* place, enum InstKind tag) {
+// otherwise, store to place if place != NULL, and return OP_NONE
+Oprand doTranslateArith(IR* target, Oprand op1, Oprand op2, const Oprand* place, enum InstKind tag) {
     assert(tag == I_ADD || tag == I_SUB || tag == I_MUL || tag == I_DIV);
-    Oprand* res = foldConstant(op1, op2, tag);
-    if (res != NULL) { return res; }
+    Oprand res = foldConstant(op1, op2, tag);
+    if (res.tag != OP_NONE) { return res; }
     else {
         if (place != NULL) {
-            writeInst(target, makeTernaryInst(tag, place, op1, op2));
+            writeInst(target, makeTernaryInst(tag, *place, op1, op2));
         }
-        return NULL;
+        return res;
     }
 }
 
 // use this function to perform constant folding
-Oprand* translateArith(IR* target, Node* exp1, Node* exp2, SymbolTable table,
-    Oprand* place, enum InstKind tag) {
+Oprand translateArith(IR* target, Node* exp1, Node* exp2, SymbolTable table,
+    const Oprand* place, enum InstKind tag) {
     assert(tag == I_ADD || tag == I_SUB || tag == I_MUL || tag == I_DIV);
     assert(exp1->tag == Exp && exp2->tag == Exp);
     DO_TRANSLATE_EXP(target, exp1, table, t1);
     DO_TRANSLATE_EXP(target, exp2, table, t2);
-    Oprand* res = foldConstant(t1, t2, tag);
-    if (res != NULL) { return res; }
-    else {
-        if (place != NULL) {
-            writeInst(target, makeTernaryInst(tag, place, t1, t2));
-        }
-        return NULL;
-    }
+    return doTranslateArith(target, t1, t2, place, tag);
+}
+
+// the function calls take their arguments in a reversed order
+static void writeArgs(IR* target, ArgList* args, int no) {
+    if (args == NULL) { return; }
+    writeArgs(target, args->next, no + 1);
+    writeInst(target, makeBinaryInst(I_ARG, args->argVal, makeLitOp(no)));
 }
 
 // optimization: for lit & id, just return the corresponding oprand, which saves one instruction
-// for the other cases, save the result to `place`, and return `NULL`
+// for the other cases, save the result to `place`, and return OP_NONE
 // when `place` == NULL, only the side effects of the expression will be generated
-Oprand* translateExp(IR* target, Node* root, SymbolTable table, Oprand* place) {
+Oprand translateExp(IR* target, Node* root, SymbolTable table, const Oprand* place) {
     assert(root->tag == Exp);
-    if (PATTERN3(root, Exp, _, Exp)) {  // binary
+    // a place for the expressions with side effects, when the value is not needed
+    Oprand temp;
+    switch (GET_PROD(root)) {
+    case P_EXP_ASSIGN:
+    {
         Node* exp1 = GET_CHILD(root, 0);
-        Node* exp2 = GET_CHILD(root, 2);
-        switch (GET_CHILD(root, 1)->content.terminal->tag) {
-        case ASSIGNOP:
-        {
-            Type* exp1T = ExpHandler(exp1, table);
-            Type* exp2T = ExpHandler(exp2, table);
-            if (exp1T->tag == PRIMITIVE) {  // simple primitive case
-                // variable case
-                if (PATTERN(exp1, _)) {
-                    Node* token = GET_CHILD(exp1, 0);
-                    assert(token->content.terminal->tag == ID);
-                    char* v = GET_TERMINAL(token, reprS);
-                    DO_TRANSLATE_EXP(target, exp2, table, t1);
-                    writeInst(target, makeBinaryInst(I_ASSGN, makeVarOp(v), t1));
-                    if (place != NULL) {
-                        writeInst(target, makeBinaryInst(I_ASSGN, place, makeVarOp(v)));
-                    }
+        Node* exp2 = GET_CHILD(root, 1);
+        Type* exp1T = GET_TYPE(exp1);
+        Type* exp2T = GET_TYPE(exp2);
+        if (exp1T->tag == PRIMITIVE) {  // simple primitive case
+            // variable case
+            if (GET_PROD(exp1) == P_EXP_ID) {
+                Oprand v = makeLocalOp(target, GET_ENTRY(GET_CHILD(exp1, 0)));
+                DO_TRANSLATE_EXP(target, exp2, table, t1);
+                writeInst(target, makeBinaryInst(I_ASSGN, v, t1));
+                if (place != NULL) {
+                    writeInst(target, makeBinaryInst(I_ASSGN, *place, v));
                 }
-                // array case
-                else if (PATTERN4(exp1, Exp, _, Exp, _)) {
-                    // first calculate the address
-                    Oprand* addr = newTempVar();
-                    translateArray(target, exp1, table, addr);
-                    // then calculate the rhs
-                    DO_TRANSLATE_EXP(target, exp2, table, rhs);
-                    // then save
-                    writeInst(target, makeBinaryInst(I_SAVE, addr, rhs));
-                    // the expression value
-                    if (place != NULL) {
-                        writeInst(target, makeBinaryInst(I_ASSGN, place, rhs));
-                    }
-                }
-            }
-            else if (exp1T->tag == ARRAY) {  // array case
-                // first calculate the base address of the lhs
-                Oprand* addr1 = newTempVar();
-                translateArray(target, exp1, table, addr1);
-                int lhsSize = getArraySize(exp1T);
-                // and the rhs must be an array as well
-                // calculate its address
-                Oprand* addr2 = newTempVar();
-                translateArray(target, exp2, table, addr2);
-                int rhsSize = getArraySize(exp2T);
-                // then copy the rhs to lhs, until one of them reaches its end
-                copyArray(target, addr1, lhsSize, addr2, rhsSize);
-                // quite tricky here, the value of an array assignment is actually not defined
-                // for a UB, any value is acceptable
-                return makeLitOp(0);
             }
+            // array element & structure field case
             else {
-                // no struct here
-                printf("structures are not supported\n");
-                exit(0);
+                // first calculate the address
+                Oprand addr;
+                int offset = 0;
+                translateAddress(target, exp1, table, &addr, &offset);
+                // then calculate the rhs
+                DO_TRANSLATE_EXP(target, exp2, table, rhs);
+                // then save
+                writeInst(target, makeTernaryInst(I_SAVE, addr, rhs, makeLitOp(offset)));
+                // the expression value
+                if (place != NULL) {
+                    writeInst(target, makeBinaryInst(I_ASSGN, *place, rhs));
+                }
             }
-            break;
         }
-        case PLUS:return translateArith(target, exp1, exp2, table, place, I_ADD);
-        case MINUS:return translateArith(target, exp1, exp2, table, place, I_SUB);
-        case STAR:return translateArith(target, exp1, exp2, table, place, I_MUL);
-        case DIV:return translateArith(target, exp1, exp2, table, place, I_DIV);
-        case RELOP: case AND: case OR: goto cond_expr;
-        default: assert(0);
+        else {  // array & structure case
+            // first calculate the base address of the lhs
+            Oprand addr1, addr2;
+            int offset1 = 0, offset2 = 0;
+            translateAddress(target, exp1, table, &addr1, &offset1);
+            int lhsSize = getTypeSize(target, exp1T);
+            // and the rhs must be of the same kind
+            // calculate its address
+            translateAddress(target, exp2, table, &addr2, &offset2);
+            int rhsSize = getTypeSize(target, exp2T);
+            // then copy the rhs to lhs, until one of them reaches its end
+            copyMemory(target, addr1, offset1, lhsSize, addr2, offset2, rhsSize);
+            // quite tricky here, the value of an array assignment is actually not defined
+            // for a UB, any value is acceptable
+            return makeLitOp(0);
         }
+        break;
     }
-    else if (PATTERN3(root, _, Exp, _)) {   // (Exp)
-        return translateExp(target, GET_CHILD(root, 1), table, place);
-    }
-    else if (PATTERN2(root, _, Exp)) {  // -Exp & !Exp
-        switch (GET_CHILD(root, 0)->content.terminal->tag) {
-        case MINUS:
-        {
-            DO_TRANSLATE_EXP(target, GET_CHILD(root, 1), table, t1);
-            return doTranslateArith(target, makeLitOp(0), t1, place, I_SUB);
+    case P_EXP_PLUS: return translateArith(target, GET_CHILD(root, 0), GET_CHILD(root, 1), table, place, I_ADD);
+    case P_EXP_MINUS: return translateArith(target, GET_CHILD(root, 0), GET_CHILD(root, 1), table, place, I_SUB);
+    case P_EXP_STAR: return translateArith(target, GET_CHILD(root, 0), GET_CHILD(root, 1), table, place, I_MUL);
+    case P_EXP_DIV: return translateArith(target, GET_CHILD(root, 0), GET_CHILD(root, 1), table, place, I_DIV);
+    case P_EXP_RELOP: case P_EXP_AND: case P_EXP_OR: case P_EXP_NOT: goto cond_expr;
+    case P_EXP_PAREN:   // (Exp)
+        return translateExp(target, GET_CHILD(root, 0), table, place);
+    case P_EXP_CALL_EMPTY:  // ID()
+    {
+        Atom fname = GET_NAME(GET_CHILD(root, 0));
+        // a place is needed here, to perform a side effect
+        if (place == NULL) {
+            temp = newTempVar(target);
+            place = &temp;
         }
-        case NOT: goto cond_expr;
-        default: assert(0);
+        if (fname == atomRead) {
+            writeInst(target, makeUnaryInst(I_READ, *place));
         }
+        else {
+            writeInst(target, makeBinaryInst(I_CALL, *place, makeFuncOp(fname)));
+        }
+        break;
+    }
+    case P_EXP_NEG:     // -Exp
+    {
+        DO_TRANSLATE_EXP(target, GET_CHILD(root, 0), table, t1);
+        return doTranslateArith(target, makeLitOp(0), t1, place, I_SUB);
     }
-    else if (PATTERN4(root, _, _, Args, _)) {   // ID(Args)
-        char* fname = GET_TERMINAL(GET_CHILD(root, 0), reprS);
-        ArgList* args = translateArgs(target, GET_CHILD(root, 2), table);
-        if (strcmp(fname, "write") == 0) {
+    case P_EXP_CALL:    // ID(Args)
+    {
+        Atom fname = GET_NAME(GET_CHILD(root, 0));
+        ArgList* args = translateArgs(target, GET_CHILD(root, 1), table);
+        if (fname == atomWrite) {
             writeInst(target, makeUnaryInst(I_WRITE, args->argVal));
             if (place != NULL) {
-                writeInst(target, makeBinaryInst(I_ASSGN, place, makeLitOp(0)));
+                writeInst(target, makeBinaryInst(I_ASSGN, *place, makeLitOp(0)));
             }
         }
         else {
-            IRNode* p = target->tail;
-            int no;
-            // in a reversed order
-            for (no = 0; args != NULL; args = args->next, no++) {
-                insertInst(target, p, makeBinaryInst(I_ARG, args->argVal, makeLitOp(no)));
-            }
+            writeArgs(target, args, 0);
             // a place is needed for a function call instruction
-            if (place == NULL) { place = newTempVar(); }
-            writeInst(target, makeBinaryInst(I_CALL, place, makeLabelOp(fname)));
-        }
-    }
-    else if (PATTERN3(root, _, _, _)) {      // ID()
-        char* fname = GET_TERMINAL(GET_CHILD(root, 0), reprS);
-        if (strcmp(fname, "read") == 0) {
-            // a place is needed here, to perform a side effect
-            if (place == NULL) { place = newTempVar(); }
-            writeInst(target, makeUnaryInst(I_READ, place));
-        }
-        else {
-            // a place is needed here, to perform a side effect
-            if (place == NULL) { place = newTempVar(); }
-            writeInst(target, makeBinaryInst(I_CALL, place, makeLabelOp(fname)));
+            if (place == NULL) {
+                temp = newTempVar(target);
+                place = &temp;
+            }
+            writeInst(target, makeBinaryInst(I_CALL, *place, makeFuncOp(fname)));
         }
+        break;
     }
-    else if (PATTERN4(root, Exp, _, Exp, _)) {   // Exp[Exp]
+    case P_EXP_INDEX:   // Exp[Exp]
+    case P_EXP_FIELD:   // Exp.ID
+    {
         // right value here, the left-value case is handled in assign expr
         // first calculate the address
-        // TODO: when `place` is NULL, the addr is also redundant
-        Oprand* addr = newTempVar();
-        translateArray(target, root, table, addr);
+        Oprand addr;
+        int offset = 0;
+        translateAddress(target, root, table, &addr, &offset);
         if (place != NULL) {
-            if (ExpHandler(root, table)->tag == PRIMITIVE) {
-                // if it is the last dimension, then dereference
-                writeInst(target, makeBinaryInst(I_LOAD, place, addr));
+            if (GET_TYPE(root)->tag == PRIMITIVE) {
+                // if it is an int, then dereference
+                writeInst(target, makeTernaryInst(I_LOAD, *place, addr, makeLitOp(offset)));
+            }
+            else if (offset != 0) {
+                // an array or a structure is referred to by its address
+                doTranslateArith(target, addr, makeLitOp(offset), place, I_ADD);
             }
             else {
-                writeInst(target, makeBinaryInst(I_ASSGN, place, addr));
+                writeInst(target, makeBinaryInst(I_ASSGN, *place, addr));
             }
         }
+        break;
     }
-    else if (PATTERN3(root, Exp, _, _)) {    // Exp.ID
-        printf("record field is not available");
-        exit(0);
-    }
-    else if (PATTERN(root, TOKEN)) {         // lit & id, base case
-        Node* token = GET_CHILD(root, 0);
-        int i;
-        char* v;
-        switch (token->content.terminal->tag) {
-        case INT:
-            i = GET_TERMINAL(token, intLit);
-            return makeLitOp(i);
-        case ID:
-            v = GET_TERMINAL(token, reprS);
-            return makeVarOp(v);
-        case FLOAT:
-            printf("float literal is not available");
-            exit(0);
-        default: assert(0);
-        }
+    // lit & id, base case
+    case P_EXP_INT:
+        return makeLitOp(GET_TERMINAL(GET_CHILD(root, 0), intLit));
+    case P_EXP_ID:
+        return makeLocalOp(target, GET_ENTRY(GET_CHILD(root, 0)));
+    case P_EXP_FLOAT:
+        printf("float literal is not available");
+        UNSUPPORTED(target);
+    default: assert(0);
     }
-    CATCH_ALL;
-    return NULL;
+    return makeNoneOp();
 
 cond_expr:
     {
         // TODO: how to eliminate the NULL `place` here?
-        if (place == NULL) { place = newTempVar(); }
-        Oprand* l1 = newLabel();
-        Oprand* l2 = newLabel();
-        writeInst(target, makeBinaryInst(I_ASSGN, place, makeLitOp(0)));
+        if (place == NULL) {
+            temp = newTempVar(target);
+            place = &temp;
+        }
+        Oprand l1 = newLabel(target);
+        Oprand l2 = newLabel(target);
+        writeInst(target, makeBinaryInst(I_ASSGN, *place, makeLitOp(0)));
         translateCond(target, root, l1, l2, table);
         writeInst(target, makeUnaryInst(I_LABEL, l1));
-        writeInst(target, makeBinaryInst(I_ASSGN, place, makeLitOp(1)));
+        writeInst(target, makeBinaryInst(I_ASSGN, *place, makeLitOp(1)));
         writeInst(target, makeUnaryInst(I_LABEL, l2));
-        return NULL;
+        return makeNoneOp();
     }
 }
 
-void translateCond(IR* target, Node* root, Oprand* labelTrue, Oprand* labelFalse, SymbolTable table) {
+void translateCond(IR* target, Node* root, Oprand labelTrue, Oprand labelFalse, SymbolTable table) {
     assert(root->tag == Exp);
-    assert(labelTrue->tag == OP_LABEL);
-    assert(labelFalse->tag == OP_LABEL);
-    if (PATTERN3(root, Exp, _, Exp)) {
-        Node* exp1 = GET_CHILD(root, 0);
-        Node* op = GET_CHILD(root, 1);
-        Node* exp2 = GET_CHILD(root, 2);
-        switch (op->content.terminal->tag) {
-        case RELOP:
-        {
-            DO_TRANSLATE_EXP(target, exp1, table, t1);
-            DO_TRANSLATE_EXP(target, exp2, table, t2);
-            enum InstKind ik = getRelOp(GET_TERMINAL(op, relOp));
-            writeInst(target, makeTernaryInst(ik, t1, t2, labelTrue));
-            writeInst(target, makeUnaryInst(I_GOTO, labelFalse));
-            return;
-        }
-        case AND:
-        {
-            Oprand* l1 = newLabel();
-            translateCond(target, exp1, l1, labelFalse, table);
-            writeInst(target, makeUnaryInst(I_LABEL, l1));
-            translateCond(target, exp2, labelTrue, labelFalse, table);
-            return;
-        }
-        case OR:
-        {
-            Oprand* l1 = newLabel();
-            translateCond(target, exp1, labelTrue, l1, table);
-            writeInst(target, makeUnaryInst(I_LABEL, l1));
-            translateCond(target, exp2, labelTrue, labelFalse, table);
-            return;
-        }
-        default: goto otherwise;
-        }
+    assert(labelTrue.tag == OP_LABEL);
+    assert(labelFalse.tag == OP_LABEL);
+    switch (GET_PROD(root)) {
+    case P_EXP_RELOP:
+    {
+        DO_TRANSLATE_EXP(target, GET_CHILD(root, 0), table, t1);
+        DO_TRANSLATE_EXP(target, GET_CHILD(root, 1), table, t2);
+        enum InstKind ik = getRelOp(GET_TERMINAL(GET_CHILD(root, 2), relOp));
+        writeInst(target, makeTernaryInst(ik, t1, t2, labelTrue));
+        writeInst(target, makeUnaryInst(I_GOTO, labelFalse));
+        return;
     }
-    else if (PATTERN2(root, _, Exp)) {
-        switch (GET_CHILD(root, 0)->content.terminal->tag) {
-        case NOT:
-            translateCond(target, GET_CHILD(root, 1), labelFalse, labelTrue, table);
-            return;
-        default: goto otherwise;
-        }
+    case P_EXP_AND:
+    {
+        Oprand l1 = newLabel(target);
+        translateCond(target, GET_CHILD(root, 0), l1, labelFalse, table);
+        writeInst(target, makeUnaryInst(I_LABEL, l1));
+        translateCond(target, GET_CHILD(root, 1), labelTrue, labelFalse, table);
+        return;
     }
-    else {
-        goto otherwise;
+    case P_EXP_OR:
+    {
+        Oprand l1 = newLabel(target);
+        translateCond(target, GET_CHILD(root, 0), labelTrue, l1, table);
+        writeInst(target, makeUnaryInst(I_LABEL, l1));
+        translateCond(target, GET_CHILD(root, 1), labelTrue, labelFalse, table);
+        return;
     }
-    return;
-
-otherwise:
+    case P_EXP_NOT:
+        translateCond(target, GET_CHILD(root, 0), labelFalse, labelTrue, table);
+        return;
+    default:
     {
         DO_TRANSLATE_EXP(target, root, table, t1);
         writeInst(target, makeTernaryInst(I_NEGOTO, t1, makeLitOp(0), labelTrue));
         writeInst(target, makeUnaryInst(I_GOTO, labelFalse));
     }
+    }
 }
 
 void translateStmt(IR* target, Node* root, SymbolTable table) {
     assert(root->tag == Stmt);
-    if (PATTERN2(root, Exp, _)) {   // Exp;
+    switch (GET_PROD(root)) {
+    case P_STMT_EXP: // Exp;
         translateExp(target, GET_CHILD(root, 0), table, NULL);
         return;
-    }
-    else if (PATTERN(root, CompSt)) {
+    case P_STMT_COMP_ST:
         translateCompSt(target, GET_CHILD(root, 0), table);
         return;
-    }
-    else if (PATTERN3(root, _, Exp, _)) {    // return Exp;
-        DO_TRANSLATE_EXP(target, GET_CHILD(root, 1), table, t1);
+    case P_STMT_RETURN: // return Exp;
+    {
+        DO_TRANSLATE_EXP(target, GET_CHILD(root, 0), table, t1);
         writeInst(target, makeUnaryInst(I_RET, t1));
         return;
     }
-    else if (PATTERN5(root, _, _, Exp, _, Stmt)) {  // if(Exp) Stmt || while(Exp) Stmt
-        switch (GET_CHILD(root, 0)->content.terminal->tag) {
-        case IF:
-        {
-            Oprand* l1 = newLabel();
-            Oprand* l2 = newLabel();
-            translateCond(target, GET_CHILD(root, 2), l1, l2, table);
-            writeInst(target, makeUnaryInst(I_LABEL, l1));
-            translateStmt(target, GET_CHILD(root, 4), table);
-            writeInst(target, makeUnaryInst(I_LABEL, l2));
-            return;
-        }
-        case WHILE:
-        {
-            Oprand* l1 = newLabel();
-            Oprand* l2 = newLabel();
-            Oprand* l3 = newLabel();
-            writeInst(target, makeUnaryInst(I_LABEL, l1));
-            translateCond(target, GET_CHILD(root, 2), l2, l3, table);
-            writeInst(target, makeUnaryInst(I_LABEL, l2));
-            translateStmt(target, GET_CHILD(root, 4), table);
-            writeInst(target, makeUnaryInst(I_GOTO, l1));
-            writeInst(target, makeUnaryInst(I_LABEL, l3));
-            return;
-        }
-        default: assert(0);
-        }
+    case P_STMT_IF: // if(Exp) Stmt
+    {
+        Oprand l1 = newLabel(target);
+        Oprand l2 = newLabel(target);
+        translateCond(target, GET_CHILD(root, 0), l1, l2, table);
+        writeInst(target, makeUnaryInst(I_LABEL, l1));
+        translateStmt(target, GET_CHILD(root, 1), table);
+        writeInst(target, makeUnaryInst(I_LABEL, l2));
+        return;
     }
-    else if (PATTERN7(root, _, _, Exp, _, Stmt, _, Stmt)) {
-        Oprand* l1 = newLabel();
-        Oprand* l2 = newLabel();
-        Oprand* l3 = newLabel();
-        translateCond(target, GET_CHILD(root, 2), l1, l2, table);
+    case P_STMT_WHILE: // while(Exp) Stmt
+    {
+        Oprand l1 = newLabel(target);
+        Oprand l2 = newLabel(target);
+        Oprand l3 = newLabel(target);
         writeInst(target, makeUnaryInst(I_LABEL, l1));
-        translateStmt(target, GET_CHILD(root, 4), table);
-        writeInst(target, makeUnaryInst(I_GOTO, l3));
+        translateCond(target, GET_CHILD(root, 0), l2, l3, table);
         writeInst(target, makeUnaryInst(I_LABEL, l2));
-        translateStmt(target, GET_CHILD(root, 6), table);
+        translateStmt(target, GET_CHILD(root, 1), table);
+        writeInst(target, makeUnaryInst(I_GOTO, l1));
         writeInst(target, makeUnaryInst(I_LABEL, l3));
         return;
     }
-    CATCH_ALL
-}
-
-// just lookup the symbol table, and return the corresponding definition
-NameTypePair* getVarEntry(Node* root, SymbolTable table) {
-    assert(root->tag == VarDec);
-    if (PATTERN(root, TOKEN)) {
-        char* name = GET_TERMINAL(GET_CHILD(root, 0), reprS);
-        SymbolTableNode* p;
-        for (p = table; p != NULL; p = p->next) {
-            if (p->content->tag == S_VAR
-                && strcmp(p->content->content.varDef->name, name) == 0) {
-                return p->content->content.varDef;
-            }
-        }
-        assert(0);
+    case P_STMT_IF_ELSE: // if(Exp) Stmt else Stmt
+    {
+        Oprand l1 = newLabel(target);
+        Oprand l2 = newLabel(target);
+        Oprand l3 = newLabel(target);
+        translateCond(target, GET_CHILD(root, 0), l1, l2, table);
+        writeInst(target, makeUnaryInst(I_LABEL, l1));
+        translateStmt(target, GET_CHILD(root, 1), table);
+        writeInst(target, makeUnaryInst(I_GOTO, l3));
+        writeInst(target, makeUnaryInst(I_LABEL, l2));
+        translateStmt(target, GET_CHILD(root, 2), table);
+        writeInst(target, makeUnaryInst(I_LABEL, l3));
+        return;
     }
-    else if (PATTERN4(root, VarDec, _, TOKEN, _)) { // VarDec [ Int ]
-        return getVarEntry(GET_CHILD(root, 0), table);
+    default: assert(0);
     }
-    CATCH_ALL
 }
 
 void translateDec(IR* target, Node* root, SymbolTable table) {
     assert(root->tag == Dec);
-    if (PATTERN(root, VarDec)) {
+    switch (GET_PROD(root)) {
+    case P_DEC_VAR:
+    {
         // check array here
-        NameTypePair* e = getVarEntry(GET_CHILD(root, 0), table);
-        if (e->type->tag == ARRAY) {
+        SymbolTableEntry* e = GET_ENTRY(getVarDecID(GET_CHILD(root, 0)));
+        Type* t = e->content.varDef->type;
+        if (t->tag == ARRAY || t->tag == RECORD) {
             // HACK: trick here
             // in the semantics of cmm, with the name of an array, it always refers to an address
+            // so is the name of a structure
             // However, in the IR, the name bound to a `DEC` instruction performs an extra dereference
             // thus, we perform one more reference here, just to unify the oprations with arrays
             // just behaves like `malloc`, instead of `declaration`
-            Oprand* dummyArr = newTempVar();
-            char* name = e->name;
-            int size = getArraySize(e->type);
+            Oprand dummyArr = newTempVar(target);
+            int size = getTypeSize(target, t);
             writeInst(target, makeBinaryInst(I_DEC, dummyArr, makeLitOp(size)));
-            writeInst(target, makeBinaryInst(I_ADDR, makeVarOp(name), dummyArr));
+            writeInst(target, makeBinaryInst(I_ADDR, makeLocalOp(target, e), dummyArr));
         }
+        break;
     }
-    else if (PATTERN3(root, VarDec, _, Exp)) {
+    case P_DEC_INIT:
+    {
         // initialize here
-        NameTypePair* e = getVarEntry(GET_CHILD(root, 0), table);
-        char* name = e->name;
-        DO_TRANSLATE_EXP(target, GET_CHILD(root, 2), table, rhs);
-        writeInst(target, makeBinaryInst(I_ASSGN, makeVarOp(name), rhs));
+        Oprand v = makeLocalOp(target, GET_ENTRY(getVarDecID(GET_CHILD(root, 0))));
+        DO_TRANSLATE_EXP(target, GET_CHILD(root, 1), table, rhs);
+        writeInst(target, makeBinaryInst(I_ASSGN, v, rhs));
+        break;
+    }
+    default: assert(0);
     }
-    CATCH_ALL
 }
 
 void translateDecList(IR* target, Node* root, SymbolTable table) {
     assert(root->tag == DecList);
-    if (PATTERN(root, Dec)) {
+    switch (GET_PROD(root)) {
+    case P_DEC_LIST:
         translateDec(target, GET_CHILD(root, 0), table);
-    }
-    else if (PATTERN3(root, Dec, _, DecList)) {
+        break;
+    case P_DEC_LIST_CONS:
         translateDec(target, GET_CHILD(root, 0), table);
-        translateDecList(target, GET_CHILD(root, 2), table);
+        translateDecList(target, GET_CHILD(root, 1), table);
+        break;
+    default: assert(0);
     }
-    CATCH_ALL
 }
 
 void translateDef(IR* target, Node* root, SymbolTable table) {
     assert(root->tag == Def);
-    if (PATTERN3(root, Specifier, DecList, _)) {
+    switch (GET_PROD(root)) {
+    case P_DEF:
         translateDecList(target, GET_CHILD(root, 1), table);
+        break;
+    default: assert(0);
     }
-    CATCH_ALL
 }
 
 void translateDefList(IR* target, Node* root, SymbolTable table) {
     if (root == NULL) return;
     assert(root->tag == DefList);
-    if (root->content.nonterminal.childNum == 2) {
+    switch (GET_PROD(root)) {
+    case P_DEF_LIST:
         translateDef(target, GET_CHILD(root, 0), table);
         translateDefList(target, GET_CHILD(root, 1), table);
+        break;
+    default: assert(0);
     }
-    CATCH_ALL
 }
 
 void translateCompSt(IR* target, Node* root, SymbolTable table) {
     assert(root->tag == CompSt);
-    if (root->content.nonterminal.childNum == 4) {  // { DefList StmtList }
-        translateDefList(target, GET_CHILD(root, 1), table);
-        translateStmtList(target, GET_CHILD(root, 2), table);
+    switch (GET_PROD(root)) {
+    case P_COMP_ST: // { DefList StmtList }
+        translateDefList(target, GET_CHILD(root, 0), table);
+        translateStmtList(target, GET_CHILD(root, 1), table);
+        break;
+    default: assert(0);
     }
-    CATCH_ALL
 }
 
 void translateStmtList(IR* target, Node* root, SymbolTable table) {
@@ -3,79 +3,148 @@
 #include"parser.h"
 #include"semantics.h"
 #include<stdio.h>
+#include<setjmp.h>
 
-enum OprandKind { OP_VAR, OP_LIT, OP_LABEL };
+// the oprands are small values held inline by the instructions
+// OP_NONE fills the unused addresses, and stands for "no oprand" in the translation
+// the variables & labels are numbered densely within their function, the names are only for printing
+enum OprandKind { OP_NONE, OP_VAR, OP_LIT, OP_LABEL, OP_FUNC, OP_PHI };
 typedef struct Oprand {
     enum OprandKind tag;
     union {
-        char* name;     // for OP_VAR
+        int vreg;       // for OP_VAR, the user variables come first, then the temporaries
         int lit;        // for OP_LIT
-        char* label;    // for OP_LABEL
+        int label;      // for OP_LABEL
+        Atom func;      // for OP_FUNC, the callee of I_CALL or the name in I_FUNC
+        struct PhiArg* args;    // for OP_PHI, the incoming values of I_PHI
     } content;
 } Oprand;
 
+// the value a phi takes when the control comes from the block `pred`
+typedef struct PhiArg {
+    int pred;
+    Oprand value;
+} PhiArg;
+
 enum InstKind {
     I_LABEL, I_FUNC, I_ASSGN, I_ADD,
     I_SUB, I_MUL, I_DIV, I_ADDR,
     I_LOAD, I_SAVE, I_GOTO, 
     I_EQGOTO, I_NEGOTO, I_LTGOTO, I_GTGOTO, I_LEGOTO, I_GEGOTO,
     I_RET, I_DEC, I_ARG, I_CALL,
-    I_PARAM, I_READ, I_WRITE
+    I_PARAM, I_READ, I_WRITE,
+    // only in the SSA form: `x := PHI(args)`, with an OP_PHI array of `addrs[2]` args
+    I_PHI,
+    // the moves made by the translation out of SSA, the same as I_ASSGN otherwise
+    I_COPY
 };
 typedef struct Instruction {
     enum InstKind tag;
-    Oprand* addrs[3];    // 3 addresses
+    Oprand addrs[3];    // 3 addresses
 } Instruction;
 
-struct IRNode {
-    Instruction* inst;
-    struct IRNode* next;
-};
-typedef struct IRNode IRNode;
+/*
+ * the instructions of a function are kept in a contiguous growable array,
+ * which starts with the I_FUNC of the function
+ * the passes & the code generation scan the arrays instead of chasing pointers
+ */
+typedef struct IRFunction {
+    Instruction* insts;
+    int instNum;
+    int instCap;
+    Atom name;
+    // vregs [0, localNum) are the parameters & local variables, named in `localNames`
+    int localNum;
+    Atom* localNames;
+    int vregNum;            // all the vregs, with the temporaries
+    int labelNum;
+    int labelBase;          // the labels of the function are printed from this number on, see `renumberLabels`
+} IRFunction;
 
 typedef struct IR {
-    struct IRNode* head;    // the head is a dummy node
-    struct IRNode* tail;    // the last node of the list
+    IRFunction* funcs;      // in the order of the definitions
+    int funcNum;
+    int funcCap;
+    int labelNum;           // the labels of all the functions
+    jmp_buf unsupported;    // where an unsupported feature abandons the translation
 } IR;
 
 struct ArgList {
-    Oprand* argVal;
+    Oprand argVal;
     struct ArgList* next;
 };
 typedef struct ArgList ArgList;
 
-int getElemSize(Type* arrayT);
+int getElemSize(IR* target, Type* arrayT);
+int getTypeSize(IR* target, Type* t);
 
-void translateProgram(IR* target, Node* root, SymbolTable table);
+// false if the program uses a feature the translation does not support
+bool translateProgram(IR* target, Node* root, SymbolTable table);
 void translateExtDefList(IR* target, Node* root, SymbolTable table);
 void translateExtDef(IR* target, Node* root, SymbolTable table);
-void translateFuncParam(IR* target, Node* root, SymbolTable table);
+void translateFuncParam(IR* target, Node* root);
 ArgList* translateArgs(IR* target, Node* root, SymbolTable table);
-Oprand* translateExp(IR* target, Node* root, SymbolTable table, Oprand* place);
-void translateCond(IR* target, Node* root, Oprand* labelTrue, Oprand* labelFalse, SymbolTable table);
+Oprand translateExp(IR* target, Node* root, SymbolTable table, const Oprand* place);
+void translateCond(IR* target, Node* root, Oprand labelTrue, Oprand labelFalse, SymbolTable table);
 void translateStmt(IR* target, Node* root, SymbolTable table);
 void translateCompSt(IR* target, Node* root, SymbolTable table);
 void translateStmtList(IR* target, Node* root, SymbolTable table);
-Type* translateArray(IR* target, Node* root, SymbolTable table, Oprand* place);
-Oprand* doTranslateArith(IR* target, Oprand* op1, Oprand* op2, Oprand* place, enum InstKind tag);
+void translateAddress(IR* target, Node* root, SymbolTable table, Oprand* addr, int* offset);
+Oprand doTranslateArith(IR* target, Oprand op1, Oprand op2, const Oprand* place, enum InstKind tag);
+
+Oprand makeLabelOp(int label);
+Oprand makeLitOp(int lit);
+Oprand makeVarOp(int vreg);
+Oprand makeFuncOp(Atom func);
+Oprand makePhiOp(PhiArg* args);
+Oprand makeNoneOp();
+// the constructors check the oprands of each kind of instruction
+Instruction makeUnaryInst(enum InstKind tag, Oprand op);
+Instruction makeBinaryInst(enum InstKind tag, Oprand op1, Oprand op2);
+Instruction makeTernaryInst(enum InstKind tag, Oprand op1, Oprand op2, Oprand op3);
+
+// make room for one more element in a growable array of the arena
+void* reserveSlot(void* array, int num, int* cap, size_t elemSize);
+
+bool isCondGoto(enum InstKind tag);
+// the conditional goto taken exactly when `tag` is not
+enum InstKind negateGoto(enum InstKind tag);
+// the value of `a tag b` for the arithmetic, false when it has none, e.g. for a division by 0
+bool evalArith(enum InstKind tag, int a, int b, int* res);
+// whether the conditional goto `tag` is taken for `a` & `b`
+bool evalCond(enum InstKind tag, int a, int b);
+// the vreg written by an instruction, -1 if none
+int instDef(const Instruction* i);
+// the addresses an instruction reads into `slots`, returns how many of them
+int useSlots(const Instruction* i, int slots[3]);
+// the vregs read by an instruction into `uses`, returns how many of them
+int instUses(const Instruction* i, int uses[3]);
+// a fresh vreg or label of a function, after the translation
+int newFuncVreg(IRFunction* func);
+int newFuncLabel(IRFunction* func);
+// give each function its range of the printed labels, after new labels are made
+void renumberLabels(IR* ir);
 
+void printInst(FILE* out, const IRFunction* func, const Instruction* i);
 void printIR(FILE* out, const IR* ir);
 IR* makeIR();
+// the number of all the instructions
+long countInsts(const IR* ir);
 
 // use this macro instead of using `translateExp` directly
 // the result will be in `place`, note that it may not be a variable
 #define DO_TRANSLATE_EXP(target, root, table, place) \
-    Oprand* place = newTempVar(); \
+    Oprand place = newTempVar(target); \
     do {\
-        Oprand* e = translateExp(target, root, table, place); \
-        place = e == NULL ? place : e; \
+        Oprand e = translateExp(target, root, table, &place); \
+        if (e.tag != OP_NONE) { place = e; } \
     } while(0);
 
 #define DO_TRANSLATE_ARITH(target, atag, op1, op2, table, place) \
-    Oprand* place = newTempVar(); \
+    Oprand place = newTempVar(target); \
     do {\
-        Oprand* e = doTranslateArith(target, op1, op2, place, atag); \
-        place = e == NULL ? place : e;\
+        Oprand e = doTranslateArith(target, op1, op2, &place, atag); \
+        if (e.tag != OP_NONE) { place = e; } \
     } while(0);
 
 #endif
\ No newline at end of file
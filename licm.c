@@ -0,0 +1,256 @@
+#include "licm.h"
+#include "ssa.h"
+#include "dom.h"
+#include<assert.h>
+#include<stdlib.h>
+
+typedef struct Loop {
+    int header;
+    int* blocks;        // in the reverse postorder, so the header first
+    int blockNum;
+} Loop;
+
+typedef struct Hoister {
+    CFG* cfg;
+    Dominators* dom;
+    Loop* loops;        // in the reverse postorder of the headers, so an outer loop before the inner ones
+    int loopNum;
+    bool* strict;
+    int* defBlock;      // the block defining each vreg, -1 for the ones never defined
+    int* mark;          // the last loop each block was found in
+    int* exits;         // the blocks of the current loop with a successor out of it
+    int exitNum;
+    bool writesMemory;  // whether the current loop has a store or a call
+} Hoister;
+
+static int compareInts(const void* a, const void* b) {
+    return *(const int*)a - *(const int*)b;
+}
+
+// the natural loop of each header, the blocks reaching a back edge to it without going through it
+static void findLoops(Hoister* h) {
+    const CFG* cfg = h->cfg;
+    int n = cfg->blockNum, pos, k;
+    int* seen = (int*)malloc((n + 1) * sizeof(int));
+    int* work = (int*)malloc((n + 1) * sizeof(int));
+    int* rpos = (int*)malloc((n + 1) * sizeof(int));
+    for (k = 0; k < n; k++) { seen[k] = -1; }
+    h->loops = (Loop*)malloc((n + 1) * sizeof(Loop));
+    h->loopNum = 0;
+    for (pos = 0; pos < cfg->orderNum; pos++) {
+        int header = cfg->order[pos], top = 0, num = 0, backs = 0;
+        const BasicBlock* block = &cfg->blocks[header];
+        seen[header] = header;
+        rpos[num++] = pos;
+        for (k = 0; k < block->predNum; k++) {
+            int p = block->preds[k];
+            if (cfg->blocks[p].rpo < 0 || !dominates(h->dom, header, p)) { continue; }
+            backs++;
+            if (seen[p] == header) { continue; }
+            seen[p] = header;
+            rpos[num++] = cfg->blocks[p].rpo;
+            work[top++] = p;
+        }
+        if (backs == 0) { continue; }
+        while (top > 0) {
+            const BasicBlock* b = &cfg->blocks[work[--top]];
+            for (k = 0; k < b->predNum; k++) {
+                int p = b->preds[k];
+                if (cfg->blocks[p].rpo < 0 || seen[p] == header) { continue; }
+                seen[p] = header;
+                rpos[num++] = cfg->blocks[p].rpo;
+                work[top++] = p;
+            }
+        }
+        qsort(rpos, num, sizeof(int), compareInts);
+        Loop* loop = &h->loops[h->loopNum++];
+        loop->header = header;
+        loop->blockNum = num;
+        loop->blocks = (int*)malloc(num * sizeof(int));
+        for (k = 0; k < num; k++) { loop->blocks[k] = cfg->order[rpos[k]]; }
+    }
+    free(seen);
+    free(work);
+    free(rpos);
+}
+
+static void analyzeLoops(Hoister* h) {
+    int n = h->cfg->blockNum, k;
+    h->dom = computeDominators(h->cfg);
+    findLoops(h);
+    h->mark = (int*)malloc((n + 1) * sizeof(int));
+    h->exits = (int*)malloc((n + 1) * sizeof(int));
+    for (k = 0; k < n; k++) { h->mark[k] = -1; }
+}
+
+static void freeLoops(Hoister* h) {
+    int k;
+    for (k = 0; k < h->loopNum; k++) { free(h->loops[k].blocks); }
+    free(h->loops);
+    free(h->mark);
+    free(h->exits);
+    freeDominators(h->cfg, h->dom);
+}
+
+// mark the blocks of a loop, and find its exits & whether it writes the memory
+static void enterLoop(Hoister* h, int id) {
+    const Loop* loop = &h->loops[id];
+    int k, j;
+    for (k = 0; k < loop->blockNum; k++) { h->mark[loop->blocks[k]] = id; }
+    h->exitNum = 0;
+    h->writesMemory = false;
+    for (k = 0; k < loop->blockNum; k++) {
+        const BasicBlock* block = &h->cfg->blocks[loop->blocks[k]];
+        for (j = 0; j < block->succNum; j++) {
+            if (h->mark[block->succs[j]] != id) {
+                h->exits[h->exitNum++] = loop->blocks[k];
+                break;
+            }
+        }
+        for (j = 0; j < block->instNum; j++) {
+            if (block->insts[j].tag == I_SAVE || block->insts[j].tag == I_CALL) { h->writesMemory = true; }
+        }
+    }
+}
+
+// the only predecessor of the header out of the loop, -1 when there are several or none
+static int findEntering(const Hoister* h, int id) {
+    const BasicBlock* header = &h->cfg->blocks[h->loops[id].header];
+    int res = -1, k;
+    for (k = 0; k < header->predNum; k++) {
+        int p = header->preds[k];
+        if (h->cfg->blocks[p].rpo < 0 || h->mark[p] == id) { continue; }
+        if (res >= 0) { return -1; }
+        res = p;
+    }
+    return res;
+}
+
+// a block can take the hoisted instructions when it goes nowhere but the header
+static bool isPreheader(const BasicBlock* b) {
+    const Instruction* last = b->instNum == 0 ? NULL : &b->insts[b->instNum - 1];
+    return b->succNum == 1 && (last == NULL || !isCondGoto(last->tag));
+}
+
+// a block run whenever the loop is, as it dominates every way out
+static bool alwaysRuns(const Hoister* h, int b) {
+    int k;
+    if (h->exitNum == 0) { return false; }
+    for (k = 0; k < h->exitNum; k++) {
+        if (!dominates(h->dom, b, h->exits[k])) { return false; }
+    }
+    return true;
+}
+
+// a literal, or a vreg with its only definition out of the loop
+static bool isInvariant(const Hoister* h, const Oprand* op, int id) {
+    if (op->tag == OP_LIT || op->tag == OP_NONE) { return true; }
+    if (op->tag != OP_VAR || !h->strict[op->content.vreg]) { return false; }
+    return h->mark[h->defBlock[op->content.vreg]] != id;
+}
+
+static bool isHoistable(const Hoister* h, const Instruction* i, int b, int id) {
+    if (i->tag != I_ASSGN && i->tag != I_ADD && i->tag != I_SUB && i->tag != I_MUL && i->tag != I_DIV
+        && i->tag != I_ADDR && i->tag != I_LOAD) { return false; }
+    if (!h->strict[i->addrs[0].content.vreg] || !isInvariant(h, &i->addrs[2], id)) { return false; }
+    if (i->tag == I_ADDR) {
+        // the array is never written, only declared
+        int d = h->defBlock[i->addrs[1].content.vreg];
+        if (d >= 0 && h->mark[d] == id) { return false; }
+    }
+    else if (!isInvariant(h, &i->addrs[1], id)) { return false; }
+    if (i->tag == I_LOAD) { return !h->writesMemory && alwaysRuns(h, b); }
+    if (i->tag == I_DIV) {
+        const Oprand* divisor = &i->addrs[2];
+        if (divisor->tag != OP_LIT || divisor->content.lit == 0 || divisor->content.lit == -1) { return alwaysRuns(h, b); }
+    }
+    return true;
+}
+
+// whether anything in the loop can move out of it, not counting the instructions
+// only becoming invariant once others move
+static bool hasInvariants(const Hoister* h, int id) {
+    const Loop* loop = &h->loops[id];
+    int k, j;
+    for (k = 0; k < loop->blockNum; k++) {
+        const BasicBlock* block = &h->cfg->blocks[loop->blocks[k]];
+        for (j = 0; j < block->instNum; j++) {
+            if (isHoistable(h, &block->insts[j], loop->blocks[k], id)) { return true; }
+        }
+    }
+    return false;
+}
+
+// move the invariant instructions of a loop to its preheader, in their order
+static void hoistLoop(Hoister* h, int id) {
+    const Loop* loop = &h->loops[id];
+    int pre = findEntering(h, id), k, j;
+    if (pre < 0 || !isPreheader(&h->cfg->blocks[pre])) { return; }
+    const BasicBlock* preBlock = &h->cfg->blocks[pre];
+    bool endsJump = preBlock->instNum != 0 && preBlock->insts[preBlock->instNum - 1].tag == I_GOTO;
+    int pos = endsJump ? preBlock->instNum - 1 : preBlock->instNum;
+    for (k = 0; k < loop->blockNum; k++) {
+        int b = loop->blocks[k];
+        BasicBlock* block = &h->cfg->blocks[b];
+        int kept = 0;
+        for (j = 0; j < block->instNum; j++) {
+            Instruction inst = block->insts[j];
+            if (isHoistable(h, &inst, b, id)) {
+                insertInst(&h->cfg->blocks[pre], pos++, inst);
+                h->defBlock[inst.addrs[0].content.vreg] = pre;
+            }
+            else { block->insts[kept++] = inst; }
+        }
+        block->instNum = kept;
+    }
+}
+
+/*
+ * first the loops with something to move and no preheader get one on their entering edge,
+ * then the loops are found again with the new blocks, and are emptied from the inner ones out
+ */
+void hoistInvariants(CFG* cfg) {
+    int vregNum = cfg->func->vregNum, id, b, k;
+    Hoister h;
+    h.cfg = cfg;
+    h.strict = findStrictVregs(cfg);
+    h.defBlock = (int*)malloc((vregNum + 1) * sizeof(int));
+    for (k = 0; k < vregNum; k++) { h.defBlock[k] = -1; }
+    for (b = 0; b < cfg->blockNum; b++) {
+        const BasicBlock* block = &cfg->blocks[b];
+        if (block->rpo < 0) { continue; }
+        for (k = 0; k < block->instNum; k++) {
+            int d = instDef(&block->insts[k]);
+            if (d >= 0) { h.defBlock[d] = b; }
+        }
+    }
+
+    analyzeLoops(&h);
+    // the edges are split once the dominators of the blocks are freed
+    int* froms = (int*)malloc((h.loopNum + 1) * sizeof(int));
+    int* tos = (int*)malloc((h.loopNum + 1) * sizeof(int));
+    int splitNum = 0;
+    for (id = 0; id < h.loopNum; id++) {
+        enterLoop(&h, id);
+        int entering = findEntering(&h, id);
+        if (entering < 0 || isPreheader(&cfg->blocks[entering]) || !hasInvariants(&h, id)) { continue; }
+        froms[splitNum] = entering;
+        tos[splitNum] = h.loops[id].header;
+        splitNum++;
+    }
+    if (splitNum > 0) {
+        freeLoops(&h);
+        for (k = 0; k < splitNum; k++) { splitEdge(cfg, froms[k], tos[k]); }
+        connectBlocks(cfg);
+        analyzeLoops(&h);
+    }
+    free(froms);
+    free(tos);
+    for (id = h.loopNum - 1; id >= 0; id--) {
+        enterLoop(&h, id);
+        hoistLoop(&h, id);
+    }
+    freeLoops(&h);
+    free(h.strict);
+    free(h.defBlock);
+}
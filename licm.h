@@ -0,0 +1,17 @@
+#ifndef LICM_H
+#define LICM_H
+
+#include"cfg.h"
+
+/*
+ * the loop invariant code motion on the SSA form
+ * the natural loops are found from the back edges, to a header dominating the jumping block,
+ * and each gets a preheader, the only block entering it from outside
+ * the pure instructions reading only literals & vregs defined out of the loop move to the preheader,
+ * the inner loops first, so an instruction can move out of several loops at once
+ * a division by a variable or a load may fault, so they only move from the blocks run whenever the loop is,
+ * and a load only from the loops with no store nor call, which may write any array
+ */
+void hoistInvariants(CFG* cfg);
+
+#endif
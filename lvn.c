@@ -0,0 +1,118 @@
+#include "lvn.h"
+#include "ssa.h"
+#include "dataflow.h"
+#include<assert.h>
+#include<stdlib.h>
+
+typedef struct ValueEntry {
+    Expr expr;
+    Oprand value;       // where the value of the expression is
+    int epoch;          // the memory the loads saw, a store or a call starts a new one
+    int slot;           // its slot in the hash table
+} ValueEntry;
+
+typedef struct ValueTable {
+    ValueEntry* entries;    // the expressions of the current block
+    int num;
+    int* table;             // open addressing over the entries, -1 for an empty slot
+    int size;               // a power of 2, at least twice the instructions of any block
+} ValueTable;
+
+// the entry of an expression, added with no value when it is new
+static ValueEntry* lookupValue(ValueTable* t, const Expr* e) {
+    unsigned i = hashExpr(e) & (t->size - 1);
+    while (t->table[i] >= 0 && !sameExpr(&t->entries[t->table[i]].expr, e)) { i = (i + 1) & (t->size - 1); }
+    if (t->table[i] < 0) {
+        ValueEntry* entry = &t->entries[t->num];
+        entry->expr = *e;
+        entry->value = makeNoneOp();
+        entry->slot = (int)i;
+        t->table[i] = t->num++;
+    }
+    return &t->entries[t->table[i]];
+}
+
+// the oprands the numbering can trust, the literals & the strict vregs
+static bool isStable(const bool* strict, const Oprand* op) {
+    return op->tag == OP_LIT || op->tag == OP_NONE || (op->tag == OP_VAR && strict[op->content.vreg]);
+}
+
+static bool isValueInst(enum InstKind tag) {
+    return tag == I_ADD || tag == I_SUB || tag == I_MUL || tag == I_DIV || tag == I_ADDR || tag == I_LOAD;
+}
+
+// a vreg copying another stands for it, which is defined before it and never written again
+static void canonicalize(const bool* strict, const int* valueOf, Oprand* op) {
+    if (op->tag == OP_VAR && strict[op->content.vreg]) { op->content.vreg = valueOf[op->content.vreg]; }
+}
+
+static void numberBlock(ValueTable* t, const bool* strict, int* valueOf, BasicBlock* block) {
+    int epoch = 0, k, j;
+    for (k = 0; k < block->instNum; k++) {
+        Instruction* i = &block->insts[k];
+        int slots[3], n = useSlots(i, slots);
+        for (j = 0; j < n; j++) { canonicalize(strict, valueOf, &i->addrs[slots[j]]); }
+        if ((i->tag == I_ASSGN || i->tag == I_COPY) && i->addrs[1].tag == OP_VAR) {
+            int x = i->addrs[0].content.vreg, y = i->addrs[1].content.vreg;
+            if (strict[x] && strict[y]) { valueOf[x] = y; }
+            continue;
+        }
+        if (i->tag == I_SAVE) {
+            epoch++;
+            // the load of the same place gets the stored value, until the memory changes again
+            if (isStable(strict, &i->addrs[0]) && isStable(strict, &i->addrs[1])) {
+                Expr e;
+                e.tag = I_LOAD;
+                e.ops[0] = i->addrs[0];
+                e.ops[1] = i->addrs[2];
+                ValueEntry* entry = lookupValue(t, &e);
+                entry->value = i->addrs[1];
+                entry->epoch = epoch;
+            }
+            continue;
+        }
+        if (i->tag == I_CALL) {
+            epoch++;
+            continue;
+        }
+        if (!isValueInst(i->tag) || !strict[i->addrs[0].content.vreg]) { continue; }
+        // the array of I_ADDR is never written, it is only declared
+        if ((i->tag != I_ADDR && !isStable(strict, &i->addrs[1])) || !isStable(strict, &i->addrs[2])) { continue; }
+        Expr e = makeExpr(i);
+        ValueEntry* entry = lookupValue(t, &e);
+        if (entry->value.tag != OP_NONE && (i->tag != I_LOAD || entry->epoch == epoch)) {
+            *i = makeBinaryInst(I_ASSGN, i->addrs[0], entry->value);
+            if (entry->value.tag == OP_VAR) { valueOf[i->addrs[0].content.vreg] = entry->value.content.vreg; }
+            continue;
+        }
+        entry->value = i->addrs[0];
+        entry->epoch = epoch;
+    }
+}
+
+void numberValues(CFG* cfg) {
+    int b, k, pos, maxInsts = 0;
+    for (b = 0; b < cfg->blockNum; b++) {
+        if (cfg->blocks[b].instNum > maxInsts) { maxInsts = cfg->blocks[b].instNum; }
+    }
+    ValueTable t;
+    t.size = 16;
+    while (t.size < 2 * maxInsts + 2) { t.size *= 2; }
+    t.entries = (ValueEntry*)malloc((maxInsts + 1) * sizeof(ValueEntry));
+    t.num = 0;
+    t.table = (int*)malloc(t.size * sizeof(int));
+    for (k = 0; k < t.size; k++) { t.table[k] = -1; }
+    bool* strict = findStrictVregs(cfg);
+    int* valueOf = (int*)malloc((cfg->func->vregNum + 1) * sizeof(int));
+    for (k = 0; k < cfg->func->vregNum; k++) { valueOf[k] = k; }
+    // the blocks in reverse postorder, so the copies are seen before the blocks they dominate
+    for (pos = 0; pos < cfg->orderNum; pos++) {
+        numberBlock(&t, strict, valueOf, &cfg->blocks[cfg->order[pos]]);
+        for (k = 0; k < t.num; k++) { t.table[t.entries[k].slot] = -1; }
+        t.num = 0;
+    }
+    free(strict);
+    free(valueOf);
+    free(t.entries);
+    free(t.table);
+}
@@ -0,0 +1,16 @@
+#ifndef LVN_H
+#define LVN_H
+
+#include"cfg.h"
+
+/*
+ * the local value numbering on the SSA form
+ * within each block, an arithmetic, I_ADDR or I_LOAD computing the same expression
+ * as an earlier one becomes a copy of its result, and a load from where a store just went
+ * becomes a copy of the stored value
+ * the vregs are never written twice in SSA, so only the loads are invalidated,
+ * by the stores & the calls, which may write any array
+ */
+void numberValues(CFG* cfg);
+
+#endif
@@ -4,39 +4,224 @@
 #include "parser.h"
 #include "semantics.h"
 #include "ir.h"
+#include "opt.h"
 #include "codegen.h"
+#include "report.h"
+#include "cache.h"
+#include<pthread.h>
+#include<string.h>
 
-extern FILE* yyin;
+// the cache directory, NULL when the cache is off
+static const char* cacheDir = NULL;
+// the flags affecting the output, they are part of the cache key
+static const char* outputFlags = "";
+// the optimizations are on unless `-O0`
+static bool optimize = true;
 
-int main(int argc, char** argv) {
-    if (argc <= 2) { return 1; }
-    FILE* f = fopen(argv[1], "r");
-    FILE* outFile = fopen(argv[2], "w");
-    if (!f) {
-        perror(argv[1]);
-        return 1;
+// compile one source file into `outPath`, everything it builds is released before returning
+static bool compile(const char* inPath, const char* outPath) {
+    SourceFile src;
+    if (!openSource(&src, inPath)) {
+        perror(inPath);
+        return false;
+    }
+    CacheKey key;
+    if (cacheDir != NULL) {
+        key = cacheKey(&src, outputFlags);
+        if (cacheFetch(cacheDir, &key, outPath)) {
+            closeSource(&src);
+            return true;
+        }
     }
+    FILE* outFile = fopen(outPath, "w");
     if (!outFile) {
-        perror(argv[2]);
-        return 1;
+        perror(outPath);
+        closeSource(&src);
+        return false;
     }
-    yyrestart(f);
-    Node* root;
-    yyparse(&root);
-    if (errorType == 0) {
+    // one arena for each phase, which holds everything the phase builds
+    Arena parseArena = ARENA_INIT;
+    Arena semanticsArena = ARENA_INIT;
+    Arena irArena = ARENA_INIT;
+
+    Compilation c;
+    CacheEntry entry;
+    bool cached = false;    // whether the assembly goes to a new cache entry as well
+    bool written = true;
+    currentArena = &parseArena;
+    beginPhase(PHASE_PARSE);
+    parseSource(&c, &src);
+    Node* root = c.root;
+    endPhase(PHASE_PARSE, reportEnabled() && c.errorType == 0 ? countNodes(root) : 0);
+    if (c.errorType == 0) {
         // printParseTree(root, 0);
+        currentArena = &semanticsArena;
+        beginPhase(PHASE_SEMANTICS);
         SymbolTable t = getSymbleTable(root);
+        endPhase(PHASE_SEMANTICS, t->size);
         // printSymbolTable(t);
         if (!semanticsError) {
+            currentArena = &irArena;
+            beginPhase(PHASE_IR);
             IR* ir = makeIR();
-            translateProgram(ir, root, t);
+            bool supported = translateProgram(ir, root, t);
+            endPhase(PHASE_IR, countInsts(ir));
             // printIR(outFile, ir);
-            generateCode(outFile, ir);
+            // the parse tree and the symbol table are dead from here on
+            arenaFree(&parseArena);
+            arenaFree(&semanticsArena);
+            if (supported && optimize) {
+                beginPhase(PHASE_OPT);
+                optimizeIR(ir);
+                endPhase(PHASE_OPT, countInsts(ir));
+            }
+            if (supported) {
+                // only the programs without any error are cached, the others print their messages
+                if (cacheDir != NULL) {
+                    cacheBeginStore(cacheDir, &key, &entry);
+                    cached = entry.file != NULL;
+                }
+                beginPhase(PHASE_CODEGEN);
+                long start = ftell(outFile);
+                written = generateCode(outFile, cached ? entry.file : NULL, ir);
+                endPhase(PHASE_CODEGEN, ftell(outFile) - start);
+            }
         }
     }
-    fclose(f);
-    fclose(outFile);
-    return 0;
+    currentArena = NULL;
+    arenaFree(&parseArena);
+    arenaFree(&semanticsArena);
+    arenaFree(&irArena);
+    closeSource(&src);
+    if (fclose(outFile) != 0) { written = false; }
+    // the entry is built from the bytes generated, never read back from the output
+    if (cached) { cacheEndStore(&entry, written); }
+    if (!written) {
+        fprintf(stderr, "%s: write failed\n", outPath);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * the pairs of a batch, which the workers take one by one
+ * all the state of a compilation is either its own or local to its thread,
+ * and the only shared things, the atoms & the report, take locks
+ */
+typedef struct BatchItem {
+    char inPath[4096], outPath[4096];
+} BatchItem;
+
+typedef struct Batch {
+    BatchItem* items;
+    int num, cap;
+    int next;           // the first pair not taken yet
+    bool ok;
+    pthread_mutex_t lock;
+} Batch;
+
+static void* compileWorker(void* arg) {
+    Batch* batch = (Batch*)arg;
+    while (true) {
+        pthread_mutex_lock(&batch->lock);
+        int k = batch->next < batch->num ? batch->next++ : -1;
+        pthread_mutex_unlock(&batch->lock);
+        if (k < 0) { return NULL; }
+        bool ok = compile(batch->items[k].inPath, batch->items[k].outPath);
+        pthread_mutex_lock(&batch->lock);
+        batch->ok = batch->ok && ok;
+        pthread_mutex_unlock(&batch->lock);
+    }
+}
+
+// the list has one `input output` pair on each line, compiled by `jobs` threads
+static bool compileBatch(const char* listPath, int jobs) {
+    FILE* list = fopen(listPath, "r");
+    if (!list) {
+        perror(listPath);
+        return false;
+    }
+    Batch batch;
+    batch.cap = 64;
+    batch.num = batch.next = 0;
+    batch.items = (BatchItem*)malloc(batch.cap * sizeof(BatchItem));
+    while (fscanf(list, "%4095s %4095s", batch.items[batch.num].inPath, batch.items[batch.num].outPath) == 2) {
+        if (++batch.num == batch.cap) {
+            batch.cap *= 2;
+            batch.items = (BatchItem*)realloc(batch.items, batch.cap * sizeof(BatchItem));
+        }
+    }
+    fclose(list);
+    batch.ok = true;
+    pthread_mutex_init(&batch.lock, NULL);
+    pthread_t* threads = (pthread_t*)malloc(jobs * sizeof(pthread_t));
+    int started = 0, i;
+    // the main thread is a worker too, and does everything when no thread starts
+    for (i = 1; i < jobs; i++) {
+        if (pthread_create(&threads[started], NULL, compileWorker, &batch) == 0) { started++; }
+    }
+    compileWorker(&batch);
+    for (i = 0; i < started; i++) { pthread_join(threads[i], NULL); }
+    pthread_mutex_destroy(&batch.lock);
+    free(threads);
+    free(batch.items);
+    return batch.ok;
+}
+
+/*
+ * usage: parser input output [-O0] [--time-report] [--trace=FILE] [--cache=DIR]
+ *        parser --batch=LIST [--jobs=N] [-O0] [--time-report] [--trace=FILE] [--cache=DIR]
+ * in batch mode all the pairs in LIST are compiled in this one process, on N threads (1 by default),
+ * the report then sums up the phases over all of them
+ * with a cache, the programs compiled before are copied from DIR without being compiled again
+ * `-O0` turns off the optimizations of the IR
+ */
+int main(int argc, char** argv) {
+    const char* paths[2];
+    int pathNum = 0;
+    bool timeReport = false;
+    const char* tracePath = NULL;
+    const char* batchPath = NULL;
+    int jobs = 1;
+    int i;
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-O0") == 0) {
+            optimize = false;
+            outputFlags = "-O0";
+        }
+        else if (strcmp(argv[i], "--time-report") == 0) {
+            timeReport = true;
+        }
+        else if (strncmp(argv[i], "--trace=", 8) == 0) {
+            tracePath = argv[i] + 8;
+        }
+        else if (strncmp(argv[i], "--batch=", 8) == 0) {
+            batchPath = argv[i] + 8;
+        }
+        else if (strncmp(argv[i], "--jobs=", 7) == 0) {
+            jobs = atoi(argv[i] + 7);
+            if (jobs < 1) { return 1; }
+        }
+        else if (strncmp(argv[i], "--cache=", 8) == 0) {
+            cacheDir = argv[i] + 8;
+        }
+        else if (pathNum < 2) {
+            paths[pathNum++] = argv[i];
+        }
+        else {
+            return 1;
+        }
+    }
+    if (batchPath != NULL ? pathNum != 0 : pathNum < 2) { return 1; }
+    // without the hash of the binary the entries could come from another compiler
+    if (cacheDir != NULL && !initCache()) { cacheDir = NULL; }
+    initReport(timeReport, tracePath);
+    // the atoms are shared by all the compilations of the process
+    initAtoms();
+    bool ok = batchPath != NULL ? compileBatch(batchPath, jobs) : compile(paths[0], paths[1]);
+    finishReport(stderr);
+    freeAtoms();
+    return ok ? 0 : 1;
 }
 
 /*
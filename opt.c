@@ -0,0 +1,32 @@
+#include "opt.h"
+#include "cfg.h"
+#include "ssa.h"
+#include "sccp.h"
+#include "lvn.h"
+#include "copyprop.h"
+#include "licm.h"
+#include "dce.h"
+#include "report.h"
+
+static void optimizeFunction(IRFunction* func) {
+    CFG* cfg = buildCFG(func);
+    SSAForm* ssa = buildSSA(cfg);
+    propagateConstants(cfg);
+    numberValues(cfg);
+    propagateCopies(cfg);
+    hoistInvariants(cfg);
+    eliminateDeadCode(cfg);
+    destructSSA(cfg, ssa);
+    linearizeCFG(cfg);
+}
+
+void optimizeIR(IR* ir) {
+    int f;
+    for (f = 0; f < ir->funcNum; f++) {
+        beginSpan(ir->funcs[f].name);
+        optimizeFunction(&ir->funcs[f]);
+        endSpan();
+    }
+    // the passes may have made new labels
+    renumberLabels(ir);
+}
@@ -0,0 +1,13 @@
+#ifndef OPT_H
+#define OPT_H
+
+#include"ir.h"
+
+/*
+ * the optimizations of the IR
+ * each function is taken into its control flow graph, transformed there,
+ * and written back as a list of instructions for the code generation
+ */
+void optimizeIR(IR* ir);
+
+#endif
@@ -3,31 +3,43 @@
 
 #include "syntax.tab.h"
 #include "common.h"
+#include "source.h"
+#include "atom.h"
+#include "arena.h"
 #include <stdlib.h>
 
+// all the objects of a compilation are allocated from the arena of the current phase
 #define NEW(varType, varName) \
-  struct varType* varName = (struct varType*)malloc(sizeof(struct varType));
-#define NEW_ARRAY(varType, varName, size) struct varType* varName = (struct varType*)malloc(size * sizeof(struct varType));
-#define GET_CHILD(root, num) (root->content.nonterminal.child[num])
-#define GET_TERMINAL(root, field) (root->content.terminal->content.field)
+  struct varType* varName = (struct varType*)arenaAlloc(currentArena, sizeof(struct varType));
+#define NEW_ARRAY(varType, varName, size) struct varType* varName = (struct varType*)arenaAlloc(currentArena, size * sizeof(struct varType));
+#define GET_CHILD(root, num) (root->child[num])
+#define GET_TERMINAL(root, field) (root->content.terminal.content.field)
 #define GET_LINENO(root) (root->content.nonterminal.column)
-#define NAME_SIZE 64
-#define NEW_NAME(dest, source) \
-    { dest = (char*)malloc(NAME_SIZE);\
-      strcpy(dest, source); } \
-
-extern int errorType;
+#define GET_PROD(root) (root->content.nonterminal.prod)
+#define GET_TYPE(root) (root->content.nonterminal.type)
+// the interned name of an ID node
+#define GET_NAME(root) (GET_TERMINAL(root, id.name))
+// the symbol an ID node refers to, bound by the semantic analysis
+#define GET_ENTRY(root) (GET_TERMINAL(root, id.entry))
+#define GET_FIELD(root) (GET_TERMINAL(root, id.field))
 
 
 enum PrimTypeTag { T_INT, T_FLOAT };
 enum RelOpTag { LT, LE, GT, GE, EQ, NE };
+typedef struct Identifier {
+    Atom name;      // the interned spelling
+    Slice slice;    // where it is spelt in the source
+    struct SymbolTableEntry* entry; // the definition it refers to, NULL until resolved
+    struct RecordField* field;      // the field it selects in `Exp.ID`, NULL until resolved
+} Identifier;
+
 /* Tokens */
 struct Token {
     enum yytokentype tag;
     union {
         int intLit;             // for INT
         float floatLit;         // for FLOAT
-        char* reprS;            // for ID 
+        Identifier id;          // for ID
         enum PrimTypeTag pType; // for TYPE
         enum RelOpTag relOp;    // for RELOP
     } content;
@@ -45,27 +57,67 @@ enum NodeTag {
     Exp, Args                                 // Expressions
 };
 
+/* the grammar rule a nonterminal is reduced by, one for each alternative in syntax.y */
+enum ProdTag {
+    P_PROGRAM, P_EXT_DEF_LIST,
+    P_EXT_DEF_VAR, P_EXT_DEF_TYPE, P_EXT_DEF_FUNC, P_EXT_DEF_DECL,
+    P_EXT_DEC_LIST, P_EXT_DEC_LIST_CONS,
+    P_SPECIFIER_TYPE, P_SPECIFIER_STRUCT,
+    P_STRUCT_DEF, P_STRUCT_TAG, P_OPT_TAG, P_TAG,
+    P_VAR_DEC_ID, P_VAR_DEC_ARRAY,
+    P_FUN_DEC_PARAMS, P_FUN_DEC_EMPTY,
+    P_VAR_LIST, P_VAR_LIST_CONS, P_PARAM_DEC,
+    P_COMP_ST, P_STMT_LIST,
+    P_STMT_EXP, P_STMT_COMP_ST, P_STMT_RETURN, P_STMT_IF, P_STMT_IF_ELSE, P_STMT_WHILE,
+    P_DEF_LIST, P_DEF, P_DEC_LIST, P_DEC_LIST_CONS, P_DEC_VAR, P_DEC_INIT,
+    P_EXP_ASSIGN, P_EXP_AND, P_EXP_OR, P_EXP_RELOP,     // Exp Exp, RELOP keeps its token as child 2
+    P_EXP_PLUS, P_EXP_MINUS, P_EXP_STAR, P_EXP_DIV,
+    P_EXP_PAREN, P_EXP_NEG, P_EXP_NOT,
+    P_EXP_CALL, P_EXP_CALL_EMPTY, P_EXP_INDEX, P_EXP_FIELD,
+    P_EXP_ID, P_EXP_INT, P_EXP_FLOAT,
+    P_ARGS, P_ARGS_CONS
+};
+
+/*
+ * only the tokens carrying a value are kept in the tree, a token node holds its token inline
+ * and a nonterminal is allocated together with its array of child nodes
+ */
 struct Node {
     enum NodeTag tag;
     union {
-        struct Token* terminal;
+        struct Token terminal;
         struct {
             int childNum;
-            struct Node** child;
             int column;
-        } nonterminal;  // array of child nodes
+            enum ProdTag prod;
+            struct Type* type;  // the type of an Exp, resolved by the semantic analysis
+        } nonterminal;
     } content;
+    struct Node* child[];   // children of a nonterminal, NULL for empty productions
 };
 typedef struct Node Node;
 
-struct Node* makeTokenNode(struct Token*);
-struct Token* makeIntLit(int);
-struct Token* makeFloatLit(float);
-struct Token* makeID(char*);
-struct Token* makeType(enum PrimTypeTag);
-struct Token* makeRelOp(enum RelOpTag);
-struct Token* makeToken(YYTOKENTYPE);
+struct Node* makeTokenNode(struct Token);
+struct Token makeIntLit(int);
+struct Token makeFloatLit(float);
+struct Token makeID(Identifier);
+struct Token makeType(enum PrimTypeTag);
+struct Token makeRelOp(enum RelOpTag);
 void printParseTree(struct Node* root, int indent);
+int countNodes(struct Node* root);
+
+/*
+ * the state of the front end for one source file
+ * the scanner and the parser are reentrant and keep all their state here or in the scanner,
+ * so independent sources can be parsed at the same time
+ */
+typedef struct Compilation {
+    SourceFile* src;
+    int errorType;          // 1 for a lexical error, 2 for a syntax error
+    struct Node* root;      // the parse tree, only when there is no error
+} Compilation;
+
+void parseSource(Compilation* c, SourceFile* src);
 
 
 #endif
\ No newline at end of file
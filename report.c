@@ -0,0 +1,135 @@
+#define _POSIX_C_SOURCE 199309L
+#include "report.h"
+#include "arena.h"
+#include<assert.h>
+#include<pthread.h>
+#include<time.h>
+
+typedef struct PhaseStat {
+    double time;            // in microseconds
+    size_t allocCount, allocBytes;
+    long items;
+} PhaseStat;
+
+// where the phase running on a thread started
+typedef struct PhaseStart {
+    double time;
+    size_t allocCount, allocBytes;
+} PhaseStart;
+
+static const char* phaseNames[PHASE_NUM] = { "parse", "semantics", "ir", "opt", "codegen" };
+static const char* itemNames[PHASE_NUM] = { "nodes", "symbols", "instructions", "instructions", "asm bytes" };
+
+static bool enabled = false;
+static bool printTable = false;
+static FILE* trace = NULL;
+// the totals & the trace are shared by the threads, the phases & spans are per thread
+static pthread_mutex_t reportLock = PTHREAD_MUTEX_INITIALIZER;
+static bool firstEvent = true;
+static int threadNum = 0;
+static PhaseStat stats[PHASE_NUM];
+static _Thread_local int tid = 0;
+static _Thread_local PhaseStart phaseStart;
+static _Thread_local enum Phase current;
+static _Thread_local const char* spanName = NULL;
+static _Thread_local double spanStart;
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// the events are streamed to the file as soon as they are complete, with the lock held
+// each thread gets a track of its own in the trace
+static void writeEvent(const char* name, const char* cat, double start, double dur) {
+    if (tid == 0) { tid = ++threadNum; }
+    fprintf(trace, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+        "\"ts\":%.3f,\"dur\":%.3f", firstEvent ? "" : ",", name, cat, tid, start, dur);
+    firstEvent = false;
+}
+
+void initReport(bool table, const char* tracePath) {
+    printTable = table;
+    if (tracePath != NULL) {
+        trace = fopen(tracePath, "w");
+        if (trace == NULL) {
+            perror(tracePath);
+        }
+        else {
+            fprintf(trace, "{\"traceEvents\":[");
+        }
+    }
+    enabled = printTable || trace != NULL;
+}
+
+bool reportEnabled() {
+    return enabled;
+}
+
+void beginPhase(enum Phase phase) {
+    if (!enabled) { return; }
+    current = phase;
+    phaseStart.allocCount = arenaAllocCount;
+    phaseStart.allocBytes = arenaAllocBytes;
+    phaseStart.time = now();
+}
+
+void endPhase(enum Phase phase, long items) {
+    if (!enabled) { return; }
+    assert(phase == current);
+    double dur = now() - phaseStart.time;
+    size_t count = arenaAllocCount - phaseStart.allocCount;
+    size_t bytes = arenaAllocBytes - phaseStart.allocBytes;
+    pthread_mutex_lock(&reportLock);
+    PhaseStat* s = &stats[phase];
+    s->time += dur;
+    s->allocCount += count;
+    s->allocBytes += bytes;
+    s->items += items;
+    if (trace != NULL) {
+        writeEvent(phaseNames[phase], "phase", phaseStart.time, dur);
+        fprintf(trace, ",\"args\":{\"allocs\":%zu,\"bytes\":%zu,\"%s\":%ld}}",
+            count, bytes, itemNames[phase], items);
+    }
+    pthread_mutex_unlock(&reportLock);
+}
+
+void beginSpan(const char* name) {
+    if (trace == NULL) { return; }
+    spanName = name;
+    spanStart = now();
+}
+
+void endSpan() {
+    if (trace == NULL || spanName == NULL) { return; }
+    double dur = now() - spanStart;
+    pthread_mutex_lock(&reportLock);
+    writeEvent(spanName, phaseNames[current], spanStart, dur);
+    fprintf(trace, "}");
+    pthread_mutex_unlock(&reportLock);
+    spanName = NULL;
+}
+
+void finishReport(FILE* out) {
+    if (printTable) {
+        int i;
+        PhaseStat total = { 0 };
+        fprintf(out, "%-10s %12s %10s %12s %12s\n", "phase", "time (ms)", "allocs", "bytes", "items");
+        for (i = 0; i < PHASE_NUM; i++) {
+            fprintf(out, "%-10s %12.3f %10zu %12zu %12ld %s\n", phaseNames[i], stats[i].time / 1e3,
+                stats[i].allocCount, stats[i].allocBytes, stats[i].items, itemNames[i]);
+            total.time += stats[i].time;
+            total.allocCount += stats[i].allocCount;
+            total.allocBytes += stats[i].allocBytes;
+        }
+        fprintf(out, "%-10s %12.3f %10zu %12zu\n", "total", total.time / 1e3,
+            total.allocCount, total.allocBytes);
+    }
+    if (trace != NULL) {
+        fprintf(trace, "\n]}\n");
+        fclose(trace);
+        trace = NULL;
+    }
+    enabled = false;
+}
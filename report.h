@@ -0,0 +1,26 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include<stdio.h>
+#include "common.h"
+
+/*
+ * the compile-time report (`--time-report`)
+ * wall time, arena allocations and the number of things built, for each phase
+ * optionally written as Chrome trace events (`--trace=FILE`), with a span for each function
+ * the phases running on several threads are summed up, and each thread has a track in the trace
+ */
+enum Phase { PHASE_PARSE, PHASE_SEMANTICS, PHASE_IR, PHASE_OPT, PHASE_CODEGEN, PHASE_NUM };
+
+void initReport(bool printTable, const char* tracePath);
+// whether anything is reported, the callers count their items only then
+bool reportEnabled();
+void beginPhase(enum Phase phase);
+void endPhase(enum Phase phase, long items);
+// spans for the functions of the program, inside the current phase
+void beginSpan(const char* name);
+void endSpan();
+// print the table to `out` and write the trace file
+void finishReport(FILE* out);
+
+#endif
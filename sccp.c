@@ -0,0 +1,311 @@
+#include "sccp.h"
+#include "ssa.h"
+#include<assert.h>
+#include<stdlib.h>
+
+// the lattice of a vreg: unknown yet, a constant, or not a constant
+enum LatticeKind { L_TOP, L_CONST, L_BOTTOM };
+typedef struct LatticeValue {
+    enum LatticeKind kind;
+    int value;          // for L_CONST
+} LatticeValue;
+
+static LatticeValue makeValue(enum LatticeKind kind, int value) {
+    LatticeValue res;
+    res.kind = kind;
+    res.value = value;
+    return res;
+}
+
+static LatticeValue meet(LatticeValue a, LatticeValue b) {
+    if (a.kind == L_TOP) { return b; }
+    if (b.kind == L_TOP) { return a; }
+    if (a.kind == L_CONST && b.kind == L_CONST && a.value == b.value) { return a; }
+    return makeValue(L_BOTTOM, 0);
+}
+
+// an instruction reading a vreg, a phi reads the vregs of all its args
+typedef struct UseSite {
+    int block;
+    int index;
+} UseSite;
+
+typedef struct Propagator {
+    CFG* cfg;
+    LatticeValue* values;
+    int* useStart;      // the uses of `v` are `uses[useStart[v]]` up to `uses[useStart[v + 1]]`
+    UseSite* uses;
+    bool* execBlock;
+    bool* execEdge;     // the edge to `succs[k]` of block `b` at `2 * b + k`
+    // the blocks just reached by an edge, each edge is pushed once
+    int* blockWork;
+    int blockTop;
+    // the vregs whose values went down
+    int* vregWork;
+    bool* inVregWork;
+    int vregTop;
+} Propagator;
+
+static LatticeValue oprandValue(const Propagator* p, const Oprand* op) {
+    if (op->tag == OP_LIT) { return makeValue(L_CONST, op->content.lit); }
+    assert(op->tag == OP_VAR);
+    return p->values[op->content.vreg];
+}
+
+static int edgeIndex(const CFG* cfg, int from, int to) {
+    const BasicBlock* b = &cfg->blocks[from];
+    int k;
+    for (k = 0; k < b->succNum; k++) {
+        if (b->succs[k] == to) { return k; }
+    }
+    assert(0);
+    return -1;
+}
+
+static void markEdge(Propagator* p, int from, int to) {
+    int e = 2 * from + edgeIndex(p->cfg, from, to);
+    if (p->execEdge[e]) { return; }
+    p->execEdge[e] = true;
+    p->blockWork[p->blockTop++] = to;
+}
+
+static void lower(Propagator* p, int v, LatticeValue x) {
+    LatticeValue old = p->values[v];
+    LatticeValue res = meet(old, x);
+    if (res.kind == old.kind && (res.kind != L_CONST || res.value == old.value)) { return; }
+    p->values[v] = res;
+    if (!p->inVregWork[v]) {
+        p->inVregWork[v] = true;
+        p->vregWork[p->vregTop++] = v;
+    }
+}
+
+static LatticeValue evalArithValue(enum InstKind tag, LatticeValue a, LatticeValue b) {
+    int res;
+    // `x * 0` is 0 whatever x is
+    if (tag == I_MUL && ((a.kind == L_CONST && a.value == 0) || (b.kind == L_CONST && b.value == 0))) {
+        return makeValue(L_CONST, 0);
+    }
+    if (a.kind == L_TOP || b.kind == L_TOP) { return makeValue(L_TOP, 0); }
+    if (a.kind == L_CONST && b.kind == L_CONST && evalArith(tag, a.value, b.value, &res)) {
+        return makeValue(L_CONST, res);
+    }
+    return makeValue(L_BOTTOM, 0);
+}
+
+// the meet of the args coming by the executable edges
+static LatticeValue evalPhi(const Propagator* p, int b, const Instruction* i) {
+    const PhiArg* args = i->addrs[1].content.args;
+    LatticeValue res = makeValue(L_TOP, 0);
+    int k;
+    for (k = 0; k < i->addrs[2].content.lit; k++) {
+        int pred = args[k].pred;
+        if (p->execEdge[2 * pred + edgeIndex(p->cfg, pred, b)]) { res = meet(res, oprandValue(p, &args[k].value)); }
+    }
+    return res;
+}
+
+static void visitBranch(Propagator* p, int b) {
+    const BasicBlock* block = &p->cfg->blocks[b];
+    const Instruction* last = block->instNum == 0 ? NULL : &block->insts[block->instNum - 1];
+    if (last != NULL && isCondGoto(last->tag)) {
+        LatticeValue x = oprandValue(p, &last->addrs[0]);
+        LatticeValue y = oprandValue(p, &last->addrs[1]);
+        assert(block->fall >= 0);
+        if (x.kind == L_TOP || y.kind == L_TOP) { return; }
+        if (x.kind == L_CONST && y.kind == L_CONST) {
+            markEdge(p, b, evalCond(last->tag, x.value, y.value) ? jumpTarget(p->cfg, last) : block->fall);
+            return;
+        }
+        markEdge(p, b, block->fall);
+        markEdge(p, b, jumpTarget(p->cfg, last));
+    }
+    else if (last != NULL && last->tag == I_GOTO) { markEdge(p, b, jumpTarget(p->cfg, last)); }
+    else if (block->fall >= 0) { markEdge(p, b, block->fall); }
+}
+
+static void visitInst(Propagator* p, int b, int k) {
+    const BasicBlock* block = &p->cfg->blocks[b];
+    const Instruction* i = &block->insts[k];
+    if (k == block->instNum - 1 && isCondGoto(i->tag)) {
+        visitBranch(p, b);
+        return;
+    }
+    int d = instDef(i);
+    if (d < 0) { return; }
+    switch (i->tag) {
+    case I_ASSGN: case I_COPY:
+        lower(p, d, oprandValue(p, &i->addrs[1]));
+        break;
+    case I_ADD: case I_SUB: case I_MUL: case I_DIV:
+        lower(p, d, evalArithValue(i->tag, oprandValue(p, &i->addrs[1]), oprandValue(p, &i->addrs[2])));
+        break;
+    case I_PHI:
+        lower(p, d, evalPhi(p, b, i));
+        break;
+    default:
+        // the memory, the calls & the input
+        lower(p, d, makeValue(L_BOTTOM, 0));
+    }
+}
+
+// the uses of each vreg, and the values at the start
+static void findUses(Propagator* p) {
+    CFG* cfg = p->cfg;
+    int vregNum = cfg->func->vregNum, pos, k, j;
+    int* useNum = (int*)calloc(vregNum + 1, sizeof(int));
+    int total = 0;
+    for (pos = 0; pos < cfg->orderNum; pos++) {
+        const BasicBlock* block = &cfg->blocks[cfg->order[pos]];
+        for (k = 0; k < block->instNum; k++) {
+            const Instruction* i = &block->insts[k];
+            int uses[3], n;
+            if (i->tag == I_PHI) {
+                const PhiArg* args = i->addrs[1].content.args;
+                for (j = 0; j < i->addrs[2].content.lit; j++) {
+                    if (args[j].value.tag == OP_VAR) { useNum[args[j].value.content.vreg]++; }
+                }
+                total += i->addrs[2].content.lit;
+                continue;
+            }
+            n = instUses(i, uses);
+            for (j = 0; j < n; j++) { useNum[uses[j]]++; }
+            total += n;
+        }
+    }
+    p->useStart = (int*)malloc((vregNum + 2) * sizeof(int));
+    p->uses = (UseSite*)malloc((total + 1) * sizeof(UseSite));
+    total = 0;
+    for (k = 0; k < vregNum; k++) {
+        p->useStart[k] = total;
+        total += useNum[k];
+        useNum[k] = 0;
+    }
+    p->useStart[vregNum] = total;
+
+    for (pos = 0; pos < cfg->orderNum; pos++) {
+        int b = cfg->order[pos];
+        const BasicBlock* block = &cfg->blocks[b];
+        for (k = 0; k < block->instNum; k++) {
+            const Instruction* i = &block->insts[k];
+            int uses[3], n, v;
+            UseSite site;
+            site.block = b;
+            site.index = k;
+            if (i->tag == I_PHI) {
+                const PhiArg* args = i->addrs[1].content.args;
+                for (j = 0; j < i->addrs[2].content.lit; j++) {
+                    if (args[j].value.tag != OP_VAR) { continue; }
+                    v = args[j].value.content.vreg;
+                    p->uses[p->useStart[v] + useNum[v]++] = site;
+                }
+                continue;
+            }
+            n = instUses(i, uses);
+            for (j = 0; j < n; j++) {
+                v = uses[j];
+                p->uses[p->useStart[v] + useNum[v]++] = site;
+            }
+        }
+    }
+    // the vregs possibly read uninitialized are never taken as constants
+    bool* strict = findStrictVregs(cfg);
+    p->values = (LatticeValue*)malloc((vregNum + 1) * sizeof(LatticeValue));
+    for (k = 0; k < vregNum; k++) { p->values[k] = makeValue(strict[k] ? L_TOP : L_BOTTOM, 0); }
+    free(strict);
+    free(useNum);
+}
+
+static void propagate(Propagator* p) {
+    CFG* cfg = p->cfg;
+    int k;
+    p->blockWork[p->blockTop++] = 0;
+    while (p->blockTop > 0 || p->vregTop > 0) {
+        if (p->blockTop > 0) {
+            int b = p->blockWork[--p->blockTop];
+            const BasicBlock* block = &cfg->blocks[b];
+            // a block is visited whole once, then only its phis see the new edges
+            if (p->execBlock[b]) {
+                int end = firstNonPhi(block);
+                for (k = 0; k < end; k++) { visitInst(p, b, k); }
+                continue;
+            }
+            p->execBlock[b] = true;
+            for (k = 0; k < block->instNum; k++) { visitInst(p, b, k); }
+            if (block->instNum == 0 || !isCondGoto(block->insts[block->instNum - 1].tag)) { visitBranch(p, b); }
+            continue;
+        }
+        int v = p->vregWork[--p->vregTop];
+        p->inVregWork[v] = false;
+        for (k = p->useStart[v]; k < p->useStart[v + 1]; k++) {
+            if (p->execBlock[p->uses[k].block]) { visitInst(p, p->uses[k].block, p->uses[k].index); }
+        }
+    }
+}
+
+// the constants into the executed blocks, with the decided branches
+static void rewriteBlocks(Propagator* p) {
+    CFG* cfg = p->cfg;
+    int b, k, j;
+    for (b = 0; b < cfg->blockNum; b++) {
+        BasicBlock* block = &cfg->blocks[b];
+        if (block->rpo < 0 || !p->execBlock[b]) { continue; }
+        // the block is compacted in place, rather than shifted at each removal
+        int kept = 0;
+        for (k = 0; k < block->instNum; k++) {
+            Instruction* i = &block->insts[k];
+            int d = instDef(i), slots[3], n;
+            if (d >= 0 && p->values[d].kind == L_CONST) { continue; }
+            if (i->tag == I_PHI) {
+                PhiArg* args = i->addrs[1].content.args;
+                for (j = 0; j < i->addrs[2].content.lit; j++) {
+                    LatticeValue x = oprandValue(p, &args[j].value);
+                    if (x.kind == L_CONST) { args[j].value = makeLitOp(x.value); }
+                }
+            }
+            else {
+                // the array of I_ADDR is never a constant
+                n = useSlots(i, slots);
+                for (j = 0; j < n; j++) {
+                    LatticeValue x = oprandValue(p, &i->addrs[slots[j]]);
+                    if (x.kind == L_CONST) { i->addrs[slots[j]] = makeLitOp(x.value); }
+                }
+            }
+            if (isCondGoto(i->tag) && i->addrs[0].tag == OP_LIT && i->addrs[1].tag == OP_LIT) {
+                if (!evalCond(i->tag, i->addrs[0].content.lit, i->addrs[1].content.lit)) { continue; }
+                *i = makeUnaryInst(I_GOTO, i->addrs[2]);
+            }
+            block->insts[kept++] = *i;
+        }
+        block->instNum = kept;
+    }
+}
+
+void propagateConstants(CFG* cfg) {
+    int n = cfg->blockNum, vregNum = cfg->func->vregNum;
+    Propagator p;
+    p.cfg = cfg;
+    findUses(&p);
+    p.execBlock = (bool*)calloc(n + 1, sizeof(bool));
+    p.execEdge = (bool*)calloc(2 * n + 1, sizeof(bool));
+    p.blockWork = (int*)malloc((2 * n + 1) * sizeof(int));
+    p.blockTop = 0;
+    p.vregWork = (int*)malloc((vregNum + 1) * sizeof(int));
+    p.inVregWork = (bool*)calloc(vregNum + 1, sizeof(bool));
+    p.vregTop = 0;
+
+    propagate(&p);
+    rewriteBlocks(&p);
+    // the blocks behind the decided branches are cut off, and so are their args to the phis
+    connectBlocks(cfg);
+    prunePhis(cfg);
+
+    free(p.values);
+    free(p.useStart);
+    free(p.uses);
+    free(p.execBlock);
+    free(p.execEdge);
+    free(p.blockWork);
+    free(p.vregWork);
+    free(p.inVregWork);
+}
@@ -0,0 +1,16 @@
+#ifndef SCCP_H
+#define SCCP_H
+
+#include"cfg.h"
+
+/*
+ * the sparse conditional constant propagation of Wegman & Zadeck, on the SSA form
+ * the vregs start unknown and only go down to a constant, then to "not a constant",
+ * while the blocks are only visited once an edge to them is found executable,
+ * so a constant deciding a branch keeps the values on the other side out of the meets
+ * the uses of the constants become literals, their definitions are dropped,
+ * the decided branches become gotos, and the blocks never executed are left unreachable
+ */
+void propagateConstants(CFG* cfg);
+
+#endif
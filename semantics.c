@@ -1,11 +1,12 @@
 #include "parser.h"
 #include "semantics.h"
+#include "report.h"
 #include<assert.h>
 #include<stdio.h>
 #include<stdlib.h>
 #include<string.h>
 
-bool semanticsError = false;
+_Thread_local bool semanticsError = false;
 
 /* error info handler */
 void raiseError(int errorType, int lineNo, char* msg) {
@@ -17,9 +18,6 @@ void raiseError(int errorType, int lineNo, char* msg) {
 /* XXX: the following constructors are just wrappers
  * and **DO CONSUME** ownership of the argument
  */
-CONS(Type, makePrimitiveType, PRIMITIVE, enum PrimTypeTag, primitive)
-CONS(Type, makeRecordType, RECORD, Record*, record)
-CONS(Type, makeArrayType, ARRAY, Array*, array)
 CONS(Type, makeFuncType, FUNC, FuncSignature*, func)
 
 CONS(SymbolTableEntry, makeStructEntry, S_STRUCT, NameTypePair*, structDef)
@@ -27,85 +25,148 @@ CONS(SymbolTableEntry, makeVarEntry, S_VAR, NameTypePair*, varDef)
 CONS(SymbolTableEntry, makeFieldEntry, S_FIELD, NameTypePair*, varDef)
 CONS(SymbolTableEntry, makeFuncEntry, S_FUNC, FunctionEntry*, funcDef)
 
-/* FieldList deep copy */
-RecordField* cloneFieldList(RecordField* rf) {
-    if (rf == NULL) { return NULL; }
-    NEW(RecordField, res);
-    NEW_NAME(res->name, rf->name);
-    res->type = cloneType(rf->type);
-    res->next = cloneFieldList(rf->next);
-    return res;
+/*
+ * the types are hash-consed and immutable, thus they are shared instead of copied
+ * the primitive types are constants, an array type is interned by its element type & size
+ * and each structure definition makes exactly one record type
+ */
+static Type intType = { PRIMITIVE, { T_INT }, &intType };
+static Type floatType = { PRIMITIVE, { T_FLOAT }, &floatType };
+
+typedef struct ArrayTypeNode {
+    Type* type;
+    struct ArrayTypeNode* next;
+} ArrayTypeNode;
+
+// the array types of the program the thread compiles, they live in its semantics arena
+static _Thread_local ArrayTypeNode** arrayTypes = NULL;
+static _Thread_local unsigned arrayTypeBucketNum = 0;
+static _Thread_local unsigned arrayTypeNum = 0;
+
+static void initTypes() {
+    arrayTypeBucketNum = 64;
+    arrayTypeNum = 0;
+    arrayTypes = (ArrayTypeNode**)arenaAlloc(currentArena, arrayTypeBucketNum * sizeof(ArrayTypeNode*));
+    memset(arrayTypes, 0, arrayTypeBucketNum * sizeof(ArrayTypeNode*));
 }
 
-/* type deep copy */
-Type* cloneType(Type* t) {
-    if (t == NULL) { return NULL; }
-    NEW(Type, res);
-    res->tag = t->tag;
+static unsigned hashArrayType(Type* elem, int size) {
+    size_t h = ((size_t)elem >> 3) * 31 + (unsigned)size;
+    return (unsigned)(h * 2654435761u) & (arrayTypeBucketNum - 1);
+}
+
+static void growArrayTypes() {
+    ArrayTypeNode** old = arrayTypes;
+    unsigned oldNum = arrayTypeBucketNum, i;
+    arrayTypeBucketNum *= 2;
+    arrayTypes = (ArrayTypeNode**)arenaAlloc(currentArena, arrayTypeBucketNum * sizeof(ArrayTypeNode*));
+    memset(arrayTypes, 0, arrayTypeBucketNum * sizeof(ArrayTypeNode*));
+    for (i = 0; i < oldNum; i++) {
+        ArrayTypeNode* p, * next;
+        for (p = old[i]; p != NULL; p = next) {
+            next = p->next;
+            unsigned h = hashArrayType(p->type->content.array->type, p->type->content.array->size);
+            p->next = arrayTypes[h];
+            arrayTypes[h] = p;
+        }
+    }
+}
+
+// the bytes of a value of the type in memory, -1 if it can not be laid out
+static int typeByteSize(Type* t) {
+    if (t == NULL) { return -1; }
     switch (t->tag) {
-    case PRIMITIVE:
-        res->content.primitive = t->content.primitive;
-        break;
-    case RECORD:
-        res->content.record = makeRecord(t->content.record->name,
-            cloneFieldList(t->content.record->fieldList));
-        break;
-    case ARRAY:
-        res->content.array = makeArray(t->content.array->size, t->content.array->type);
-        break;
-    case FUNC:
-        res->content.func = makeFuncSignature(t->content.func->retType,
-            t->content.func->params);
-        break;
-    default:
-        printf("<%d>\n", t->tag);
-        fflush(stdout);
-        assert(0);
+    case PRIMITIVE: return 4;
+    case ARRAY: return t->content.array->byteSize;
+    case RECORD: return t->content.record->byteSize;
+    default: return -1;
     }
-    return res;
 }
 
-/* delete a type and all nested types */
-void deleteType(Type* t) {
-    // TODO
+// the alignment of a value of the type in memory, all the primitives take a word
+static int typeAlign(Type* t) {
+    if (t == NULL) { return 1; }
+    switch (t->tag) {
+    case ARRAY: return typeAlign(t->content.array->type);
+    case RECORD: return t->content.record->align;
+    default: return 4;
+    }
+}
+
+// the dimensions of the elements follow the current one, so their layout is copied
+static void layoutArray(Array* array) {
+    Type* elem = array->type;
+    Array* inner = elem != NULL && elem->tag == ARRAY ? elem->content.array : NULL;
+    array->rank = inner == NULL ? 1 : inner->rank + 1;
+    array->extents = (int*)arenaAlloc(currentArena, array->rank * sizeof(int));
+    array->strides = (int*)arenaAlloc(currentArena, array->rank * sizeof(int));
+    array->extents[0] = array->size;
+    array->strides[0] = typeByteSize(elem);
+    if (inner != NULL) {
+        memcpy(array->extents + 1, inner->extents, inner->rank * sizeof(int));
+        memcpy(array->strides + 1, inner->strides, inner->rank * sizeof(int));
+    }
+    array->byteSize = array->size < 0 || array->strides[0] < 0 ? -1 : array->size * array->strides[0];
+}
+
+Type* makePrimitiveType(enum PrimTypeTag primitive) {
+    return primitive == T_INT ? &intType : &floatType;
 }
 
-/* get base type and dimension information of an array type */
-void arrayInfo(Type* array, enum PrimTypeTag* baseType, int* dimension) {
-    assert(array->tag == ARRAY);
-    if (array->content.array->type->tag == PRIMITIVE) {
-        *baseType = array->content.array->type->content.primitive;
-        *dimension = 0;
+/*
+ * the array of `size` elements of `type`, `size` is -1 for the class of all the sizes
+ * the arrays of the same base type & dimension are equal, whatever their sizes are
+ */
+Type* makeArrayType(int size, Type* type) {
+    unsigned h = hashArrayType(type, size);
+    ArrayTypeNode* p;
+    for (p = arrayTypes[h]; p != NULL; p = p->next) {
+        if (p->type->content.array->type == type && p->type->content.array->size == size) {
+            return p->type;
+        }
+    }
+    NEW(Array, array);
+    array->size = size;
+    array->type = type;
+    layoutArray(array);
+    NEW(Type, t);
+    t->tag = ARRAY;
+    t->content.array = array;
+    if (type == NULL || type->equiv == NULL) {
+        t->equiv = NULL;
+    }
+    else if (size == -1 && type == type->equiv) {
+        t->equiv = t;
     }
     else {
-        arrayInfo(array->content.array->type, baseType, dimension);
-        (*dimension)++;
+        t->equiv = makeArrayType(-1, type->equiv);
     }
+    // the class may have been interned just now, so the bucket is found again
+    if (arrayTypeNum * 4 >= arrayTypeBucketNum * 3) {
+        growArrayTypes();
+    }
+    h = hashArrayType(type, size);
+    NEW(ArrayTypeNode, node);
+    node->type = t;
+    node->next = arrayTypes[h];
+    arrayTypes[h] = node;
+    arrayTypeNum++;
+    return t;
+}
+
+// a new structure, an anonymous one is equal to no other type
+Type* makeRecordType(Record* record) {
+    NEW(Type, t);
+    t->tag = RECORD;
+    t->content.record = record;
+    t->equiv = record->name == NULL ? NULL : t;
+    return t;
 }
 
-// TODO: test this function
 /* t1 and t2 are not NULL */
 bool typeEqual(Type* t1, Type* t2) {
-    if (t1->tag != t2->tag) {
-        return false;
-    }
-    enum PrimTypeTag b1, b2;
-    int d1, d2;
-    switch (t1->tag) {
-    case PRIMITIVE:
-        return t1->content.primitive == t2->content.primitive;
-    case RECORD:    // name equivalence
-        if (t1->content.record->name == NULL || t2->content.record->name == NULL) {
-            return false;
-        }
-        return strcmp(t1->content.record->name, t2->content.record->name) == 0;
-    case ARRAY:
-        // compare the base type and dimension
-        arrayInfo(t1, &b1, &d1); arrayInfo(t2, &b2, &d2);
-        return b1 == b2 && d1 == d2;
-    default:
-        assert(0);
-    }
+    // the equivalent types share the same class, except the anonymous structures & functions
+    return t1->equiv == t2->equiv && t1->equiv != NULL;
 }
 
 // TODO: test this function
@@ -126,9 +187,9 @@ bool sameSignature(FuncSignature s1, FuncSignature s2) {
 
 // TODO: check all calls for ownership
 /* consume `type` */
-NameTypePair* makeNameTypePair(char* name, Type* type) {
+NameTypePair* makeNameTypePair(Atom name, Type* type) {
     NEW(NameTypePair, res);
-    NEW_NAME(res->name, name);
+    res->name = name;
     res->type = type;
     return res;
 }
@@ -141,57 +202,141 @@ FuncSignature* makeFuncSignature(Type* retType, RecordField* params) {
     return res;
 }
 
-FunctionEntry* makeFunctionEntry(char* name, Type* t, bool defined, int lineNo) {
+FunctionEntry* makeFunctionEntry(Atom name, Type* t, bool defined, int lineNo) {
     assert(t->tag == FUNC);
     NEW(FunctionEntry, res);
-    NEW_NAME(res->name, name);
-    res->type = cloneType(t);
+    res->name = name;
+    res->type = t;
     res->defined = defined;
     res->decLineNo = lineNo;
+    res->localNum = 0;
     return res;
 }
 
 // TODO: ownership
-RecordField* makeRecordField(char* name, Type* type, RecordField* next) {
+RecordField* makeRecordField(Atom name, Type* type, RecordField* next) {
     NEW(RecordField, res);
     res->name = name;
-    // NEW_NAME(res->name, name);
-    res->type = cloneType(type);
+    res->type = type;
     res->next = next;
+    res->offset = 0;
     return res;
 }
 
-Record* makeRecord(char* name, RecordField* fieldList) {
-    NEW(Record, res);
-    if (name == NULL) {
-        res->name == NULL;
-    }
-    else {
-        NEW_NAME(res->name, name);
+// the fields are placed in the order of their definitions, each aligned to its type
+static void layoutRecord(Record* record) {
+    RecordField* p;
+    int offset = 0, align = 1;
+    for (p = record->fieldList; p != NULL; p = p->next) {
+        int a = typeAlign(p->type), size = typeByteSize(p->type);
+        if (offset >= 0) { offset = (offset + a - 1) / a * a; }
+        p->offset = offset;
+        if (a > align) { align = a; }
+        offset = offset < 0 || size < 0 ? -1 : offset + size;
     }
+    record->align = align;
+    record->byteSize = offset < 0 ? -1 : (offset + align - 1) / align * align;
+}
+
+Record* makeRecord(Atom name, RecordField* fieldList) {
+    NEW(Record, res);
+    res->name = name;
     res->fieldList = fieldList;
+    layoutRecord(res);
     return res;
 }
 
-Array* makeArray(int size, Type* type) {
-    NEW(Array, res);
-    res->size = size;
-    res->type = cloneType(type);
-    return res;
+/* Symbol table operations */
+#define INIT_BUCKET_NUM 64
+
+static Atom entryName(const SymbolTableEntry* e) {
+    switch (e->tag) {
+    case S_STRUCT: return e->content.structDef->name;
+    case S_VAR: case S_FIELD: return e->content.varDef->name;
+    case S_FUNC: return e->content.funcDef->name;
+    default: assert(0);
+    }
+    return NULL;
+}
+
+// the atoms are interned, so the address is the identity of the name
+static unsigned hashKey(enum SymbolTag tag, Atom name) {
+    size_t h = ((size_t)name >> 3) * 31 + tag;
+    return (unsigned)(h * 2654435761u);
+}
+
+static SymbolTableNode** bucketOf(SymbolTable table, enum SymbolTag tag, Atom name) {
+    return &table->buckets[hashKey(tag, name) & (table->bucketNum - 1)];
+}
+
+SymbolTable makeSymbolTable() {
+    NEW(SymbolHashTable, t);
+    t->bucketNum = INIT_BUCKET_NUM;
+    t->buckets = (SymbolTableNode**)arenaAlloc(currentArena, t->bucketNum * sizeof(SymbolTableNode*));
+    memset(t->buckets, 0, t->bucketNum * sizeof(SymbolTableNode*));
+    t->size = 0;
+    t->newest = NULL;
+    return t;
+}
+
+// move a chain into the new buckets, the older bindings go first to keep the newer ones in front
+static void rehashChain(SymbolTable table, SymbolTableNode* p) {
+    if (p == NULL) { return; }
+    rehashChain(table, p->next);
+    SymbolTableNode** b = bucketOf(table, p->content->tag, p->name);
+    p->next = *b;
+    *b = p;
+}
+
+static void growBuckets(SymbolTable table) {
+    SymbolTableNode** old = table->buckets;
+    unsigned oldNum = table->bucketNum, i;
+    table->bucketNum *= 2;
+    table->buckets = (SymbolTableNode**)arenaAlloc(currentArena, table->bucketNum * sizeof(SymbolTableNode*));
+    memset(table->buckets, 0, table->bucketNum * sizeof(SymbolTableNode*));
+    for (i = 0; i < oldNum; i++) {
+        rehashChain(table, old[i]);
+    }
 }
 
-/* Symbol table linked list operations */
 void addEntry(SymbolTable* table, SymbolTableEntry* newEntry) {
+    SymbolTable t = *table;
+    if ((unsigned)t->size * 4 >= t->bucketNum * 3) {
+        growBuckets(t);
+    }
     NEW(SymbolTableNode, q);
+    newEntry->order = t->size++;
+    newEntry->local = -1;
     q->content = newEntry;
-    q->next = *table;
-    *table = q;
+    q->name = entryName(newEntry);
+    SymbolTableNode** b = bucketOf(t, newEntry->tag, q->name);
+    q->next = *b;
+    *b = q;
+    q->older = t->newest;
+    t->newest = q;
+}
+
+SymbolTableEntry* lookupEntry(SymbolTable table, enum SymbolTag tag, Atom name) {
+    SymbolTableNode* p;
+    for (p = *bucketOf(table, tag, name); p != NULL; p = p->next) {
+        if (p->name == name && p->content->tag == tag) {
+            return p->content;
+        }
+    }
+    return NULL;
+}
+
+// the one defined later of two entries, either can be NULL
+static SymbolTableEntry* newerEntry(SymbolTableEntry* a, SymbolTableEntry* b) {
+    if (a == NULL) { return b; }
+    if (b == NULL) { return a; }
+    return a->order > b->order ? a : b;
 }
 
 // check all functions is well-defined
 void checkFuncDef(SymbolTable table) {
     SymbolTableNode* p;
-    for (p = table; p != NULL; p = p->next) {
+    for (p = table->newest; p != NULL; p = p->older) {
         if (p->content->tag == S_FUNC
             && !p->content->content.funcDef->defined) {
             raiseError(18, p->content->content.funcDef->decLineNo, "error 18");
@@ -201,20 +346,19 @@ void checkFuncDef(SymbolTable table) {
 
 // create the initial table with predefined function `read` & `write`
 SymbolTable initSymbolTable() {
-    SymbolTable t = NULL;
-    char* readName, * writeName;
-    NEW_NAME(readName, "read");
-    NEW_NAME(writeName, "write");
+    SymbolTable t = makeSymbolTable();
     Type* readType = makeFuncType(makeFuncSignature(makePrimitiveType(T_INT), NULL));
-    RecordField* writeParam = makeRecordField("dummy", makePrimitiveType(T_INT), NULL);
+    RecordField* writeParam = makeRecordField(intern("dummy"), makePrimitiveType(T_INT), NULL);
     Type* writeType = makeFuncType(makeFuncSignature(makePrimitiveType(T_INT), writeParam));
-    addEntry(&t, makeFuncEntry(makeFunctionEntry(readName, readType, true, 0)));
-    addEntry(&t, makeFuncEntry(makeFunctionEntry(writeName, writeType, true, 0)));
+    addEntry(&t, makeFuncEntry(makeFunctionEntry(atomRead, readType, true, 0)));
+    addEntry(&t, makeFuncEntry(makeFunctionEntry(atomWrite, writeType, true, 0)));
     return t;
 }
 
 SymbolTable getSymbleTable(Node* root) {
     assert(root->tag == Program);
+    semanticsError = false;
+    initTypes();
     SymbolTable res = initSymbolTable();
     ExtDefListHandler(GET_CHILD(root, 0), &res);
     checkFuncDef(res);
@@ -228,119 +372,130 @@ void ExtDefListHandler(Node* root, SymbolTable* table) {
     ExtDefListHandler(GET_CHILD(root, 1), table);
 }
 
+// the number of the locals defined so far in the function being checked, -1 outside functions
+static _Thread_local int localNum = -1;
+
 // `isField` for field definition
-void defineVar(RecordField* def, SymbolTable* table, int lineNo, bool isField) {
-    SymbolTableNode* p;
-    bool flag;
-    // check the original table 
-    for (p = *table, flag = false; p != NULL; p = p->next) {
-        // if the variable has already been defined
-        if (p->content->tag == S_VAR
-            && strcmp(p->content->content.varDef->name, def->name) == 0) {
-            raiseError(3, lineNo, "error 3");
-            flag = true;
-            break;
-        }
-        // if field is already defined
-        if (isField && p->content->tag == S_FIELD
-            && strcmp(p->content->content.varDef->name, def->name) == 0) {
+// return the new entry, NULL if it conflicts with another one
+SymbolTableEntry* defineVar(RecordField* def, SymbolTable* table, int lineNo, bool isField) {
+    // check the original table
+    // a variable, a field or a structure of the same name, the latest one decides the error
+    SymbolTableEntry* e = newerEntry(lookupEntry(*table, S_VAR, def->name),
+        lookupEntry(*table, S_STRUCT, def->name));
+    SymbolTableEntry* field = isField ? lookupEntry(*table, S_FIELD, def->name) : NULL;
+    if (newerEntry(e, field) != NULL) {
+        if (newerEntry(e, field) == field) {
+            // if field is already defined
             raiseError(15, lineNo, "error 15");
-            flag = true;
-            break;
         }
-        // if the variable has a same name as an exist structure
-        if (p->content->tag == S_STRUCT
-            && strcmp(p->content->content.structDef->name, def->name) == 0) {
+        else {
+            // if the variable has already been defined,
+            // or it has a same name as an exist structure
             raiseError(3, lineNo, "error 3");
-            flag = true;
-            break;
         }
-        // TODO: what if var-func conflict?
+        return NULL;
     }
-    if (!flag) {    // if not defined
-        if (isField) {
-            addEntry(table, makeFieldEntry(makeNameTypePair(def->name, def->type)));
-        }
-        else {
-            addEntry(table, makeVarEntry(makeNameTypePair(def->name, def->type)));
-        }
+    // TODO: what if var-func conflict?
+    // not defined yet
+    SymbolTableEntry* res;
+    if (isField) {
+        res = makeFieldEntry(makeNameTypePair(def->name, def->type));
+        addEntry(table, res);
+    }
+    else {
+        res = makeVarEntry(makeNameTypePair(def->name, def->type));
+        addEntry(table, res);
+        if (localNum >= 0) { res->local = localNum++; }
+    }
+    return res;
+}
+
+Node* getVarDecID(Node* root) {
+    assert(root->tag == VarDec);
+    while (GET_PROD(root) == P_VAR_DEC_ARRAY) {
+        root = GET_CHILD(root, 0);
     }
+    return GET_CHILD(root, 0);
 }
 
-/* side effect */
 void ExtDefHandler(Node* root, SymbolTable* table) {
     assert(root->tag == ExtDef);
 
     Node* specifier, * extDecList, * funDec, * compSt;
     Type* t, * retType;
     RecordField* def;
-    SymbolTableNode* p;
-    bool flag;
-    if (PATTERN3(root, Specifier, ExtDecList, _)) { // ExtDef -> Specifier ExtDecList SEMI
+    switch (GET_PROD(root)) {
+    case P_EXT_DEF_VAR:     // ExtDef -> Specifier ExtDecList SEMI
         specifier = GET_CHILD(root, 0);
         extDecList = GET_CHILD(root, 1);
         t = SpecifierHandler(specifier, table);
         // side effect here, add entries
         def = ExtDecListHandler(extDecList, t);
         defineVar(def, table, GET_LINENO(root), false);
-
-    }
-    else if (PATTERN2(root, Specifier, _)) { // ExtDef -> Specifier SEMI
+        break;
+    case P_EXT_DEF_TYPE:    // ExtDef -> Specifier SEMI
         specifier = GET_CHILD(root, 0);
         // side effect here, add entry if it is a struct def
         SpecifierHandler(specifier, table);
-    }
-    else if (PATTERN3(root, Specifier, FunDec, CompSt)) { // function definition
+        break;
+    case P_EXT_DEF_FUNC:    // function definition
         specifier = GET_CHILD(root, 0);
         funDec = GET_CHILD(root, 1);
         compSt = GET_CHILD(root, 2);
+        beginSpan(GET_NAME(GET_CHILD(funDec, 0)));
         // FIXME: side effect here, is it reasonable?
         retType = SpecifierHandler(specifier, table);
+        // the parameters & the local variables are numbered from 0 in each function
+        localNum = 0;
         FunDecHandler(funDec, table, retType, true);
         CompStHandler(compSt, table, retType);
-    }
-    else if (PATTERN3(root, Specifier, FunDec, TOKEN)) { // function declaration 
+        if (GET_ENTRY(GET_CHILD(funDec, 0)) != NULL) {
+            GET_ENTRY(GET_CHILD(funDec, 0))->content.funcDef->localNum = localNum;
+        }
+        localNum = -1;
+        endSpan();
+        break;
+    case P_EXT_DEF_DECL:    // function declaration
         specifier = GET_CHILD(root, 0);
         funDec = GET_CHILD(root, 1);
-        compSt = GET_CHILD(root, 2);
         // FIXME: side effect here, is it reasonable?
         retType = SpecifierHandler(specifier, table);
         FunDecHandler(funDec, table, retType, false);
+        break;
+    default: assert(0);
     }
-    CATCH_ALL
 }
 
 RecordField* ExtDecListHandler(Node* root, Type* inputType) {
     assert(root->tag == ExtDecList);
     Node* varDec, * extDecList;
     RecordField* x, * xs;
-    if (PATTERN(root, VarDec)) {
+    switch (GET_PROD(root)) {
+    case P_EXT_DEC_LIST:
         varDec = GET_CHILD(root, 0);
-        return VarDecHandler(varDec, cloneType(inputType));
-    }
-    else if (PATTERN3(root, VarDec, TOKEN, ExtDecList)) {
+        return VarDecHandler(varDec, inputType);
+    case P_EXT_DEC_LIST_CONS:
         varDec = GET_CHILD(root, 0);
-        extDecList = GET_CHILD(root, 2);
-        x = VarDecHandler(varDec, cloneType(inputType));
+        extDecList = GET_CHILD(root, 1);
+        x = VarDecHandler(varDec, inputType);
         xs = ExtDecListHandler(extDecList, inputType);
         x->next = xs;
         return x;
+    default: assert(0);
     }
-    CATCH_ALL;
     return NULL;
 }
 
 Type* SpecifierHandler(Node* root, SymbolTable* table) {
     assert(root->tag == Specifier);
-    assert(root->content.nonterminal.childNum == 1);
     Node* child = GET_CHILD(root, 0);
-    if (PATTERN(root, TOKEN)) {   // Specifier -> TYPE
+    switch (GET_PROD(root)) {
+    case P_SPECIFIER_TYPE:      // Specifier -> TYPE
         return makePrimitiveType(GET_TERMINAL(child, pType));
-    }
-    else if (PATTERN(root, StructSpecifier)) {
+    case P_SPECIFIER_STRUCT:
         return StructSpecifierHandler(child, table);
+    default: assert(0);
     }
-    CATCH_ALL;
     return NULL;
 }
 
@@ -360,30 +515,28 @@ Type* StructSpecifierHandler(Node* root, SymbolTable* table) {
     Node* tag, * optTag, * defList;
     RecordField* fieldList;
     Type* t;
-    SymbolTableNode* p;
     bool containsExp = false;
-    if (PATTERN2(root, _, Tag)) {
+    switch (GET_PROD(root)) {
+    case P_STRUCT_TAG:
+    {
         // using defined structure
-        tag = GET_CHILD(root, 1);
+        tag = GET_CHILD(root, 0);
         Node* id = GET_CHILD(tag, 0);
         assert(id->tag == TOKEN);
         // lookup the tag in the table
-        for (p = *table; p != NULL; p = p->next) {
-            if (p->content->tag != S_STRUCT) { continue; }
-            if (strcmp(GET_TERMINAL(id, reprS),
-                p->content->content.structDef->name) == 0) {
-                // defined entry found, return a COPY type
-                return cloneType(p->content->content.structDef->type);
-            }
+        SymbolTableEntry* e = lookupEntry(*table, S_STRUCT, GET_NAME(id));
+        if (e != NULL) {
+            // defined entry found, the type is shared
+            return e->content.structDef->type;
         }
         // no entry found, raise ERROR 17
         raiseError(17, GET_LINENO(root), "error 17");
         return NULL;
     }
-    else if (root->content.nonterminal.childNum == 5) {
+    case P_STRUCT_DEF:
         // define new structure
-        optTag = GET_CHILD(root, 1); // XXX: nullable
-        defList = GET_CHILD(root, 3); // XXX: nullable
+        optTag = GET_CHILD(root, 0); // XXX: nullable
+        defList = GET_CHILD(root, 1); // XXX: nullable
         fieldList = DefListHandler(defList, table, &containsExp, true);
         if (containsExp) {
             raiseError(15, GET_LINENO(root), "error 15");
@@ -391,7 +544,7 @@ Type* StructSpecifierHandler(Node* root, SymbolTable* table) {
         }
         // TODO: maybe refractor here
         if (optTag) {
-            char* name = GET_TERMINAL(GET_CHILD(optTag, 0), reprS);
+            Atom name = GET_NAME(GET_CHILD(optTag, 0));
             t = makeRecordType(makeRecord(name, fieldList));
         }
         else {
@@ -401,26 +554,22 @@ Type* StructSpecifierHandler(Node* root, SymbolTable* table) {
             assert(optTag->tag == OptTag);
             // lookup the tag in the table
             Node* tag = GET_CHILD(optTag, 0);
-            for (p = *table; p != NULL; p = p->next) {
-                if (p->content->tag != S_STRUCT) { continue; }
-                if (strcmp(GET_TERMINAL(tag, reprS),
-                    p->content->content.structDef->name) == 0) {
-                    // redefinition, raise ERROR 16
-                    raiseError(16, GET_LINENO(root), "error 16");
-                    return NULL;
-                }
+            if (lookupEntry(*table, S_STRUCT, GET_NAME(tag)) != NULL) {
+                // redefinition, raise ERROR 16
+                raiseError(16, GET_LINENO(root), "error 16");
+                return NULL;
             }
             // no entry found, define a new entry in the table
             // TODO: check ownership
-            SymbolTableEntry* e = makeStructEntry(makeNameTypePair(GET_TERMINAL(tag, reprS), t));
+            SymbolTableEntry* e = makeStructEntry(makeNameTypePair(GET_NAME(tag), t));
             addEntry(table, e);
         }
         else {          // otherwise
             // TODO: what to do here?
         }
         return t;   // return the type
+    default: assert(0);
     }
-    CATCH_ALL;
     return NULL;
 }
 
@@ -440,7 +589,9 @@ Type* StructSpecifierHandler(Node* root, SymbolTable* table) {
 RecordField* DefListHandler(Node* root, SymbolTable* table, bool* containsExp, bool isField) {
     if (root == NULL) { return NULL; }
     assert(root->tag == DefList);
-    if (root->content.nonterminal.childNum == 2) {
+    switch (GET_PROD(root)) {
+    case P_DEF_LIST:
+    {
         Node* def = GET_CHILD(root, 0);
         Node* defList = GET_CHILD(root, 1);
         RecordField* x = DefHandler(def, table, containsExp, isField);
@@ -454,7 +605,8 @@ RecordField* DefListHandler(Node* root, SymbolTable* table, bool* containsExp, b
         tail->next = xs;
         return x;
     }
-    CATCH_ALL
+    default: assert(0);
+    }
 }
 
 /*
@@ -463,15 +615,17 @@ RecordField* DefListHandler(Node* root, SymbolTable* table, bool* containsExp, b
  */
 RecordField* DefHandler(Node* root, SymbolTable* table, bool* containsExp, bool isField) {
     assert(root->tag == Def);
-    if (PATTERN3(root, Specifier, DecList, _)) {
+    switch (GET_PROD(root)) {
+    case P_DEF:
+    {
         Node* specifier = GET_CHILD(root, 0);
         Node* decList = GET_CHILD(root, 1);
         Type* t = SpecifierHandler(specifier, table);
         RecordField* res = DecListHandler(decList, table, t, containsExp, isField);
-        deleteType(t);
         return res;
     }
-    CATCH_ALL
+    default: assert(0);
+    }
 }
 
 /*
@@ -482,19 +636,19 @@ RecordField* DecListHandler(Node* root, SymbolTable* table, Type* inputType, boo
     assert(root->tag == DecList);
     Node* dec, * decList;
     RecordField* x, * xs;
-    if (PATTERN(root, Dec)) {    // base case
+    switch (GET_PROD(root)) {
+    case P_DEC_LIST: // base case
         dec = GET_CHILD(root, 0);
-        return DecHandler(dec, table, cloneType(inputType), containsExp, isField);
-    }
-    else if (PATTERN3(root, Dec, _, DecList)) {  // recursive case
+        return DecHandler(dec, table, inputType, containsExp, isField);
+    case P_DEC_LIST_CONS: // recursive case
         dec = GET_CHILD(root, 0);
-        decList = GET_CHILD(root, 2);
-        x = DecHandler(dec, table, cloneType(inputType), containsExp, isField);
-        xs = DecListHandler(decList, table, cloneType(inputType), containsExp, isField);
+        decList = GET_CHILD(root, 1);
+        x = DecHandler(dec, table, inputType, containsExp, isField);
+        xs = DecListHandler(decList, table, inputType, containsExp, isField);
         x->next = xs;
         return x;
+    default: assert(0);
     }
-    CATCH_ALL
 }
 
 /*
@@ -504,20 +658,24 @@ RecordField* DecListHandler(Node* root, SymbolTable* table, Type* inputType, boo
 RecordField* DecHandler(Node* root, SymbolTable* table, Type* inputType, bool* containsExp, bool isField) {
     assert(root->tag == Dec);
     Node* varDec = NULL;
-    if (PATTERN(root, VarDec)) {
+    switch (GET_PROD(root)) {
+    case P_DEC_VAR:
         varDec = GET_CHILD(root, 0);
-    }
-    else if (PATTERN3(root, VarDec, _, Exp)) {
+        break;
+    case P_DEC_INIT:
+    {
         // TODO: what to do with the Exp?
         varDec = GET_CHILD(root, 0);
-        Type* t = ExpHandler(GET_CHILD(root, 2), *table);
+        Type* t = ExpHandler(GET_CHILD(root, 1), *table);
         *containsExp = true;
+        break;
+    }
+    default: assert(0);
     }
-    CATCH_ALL;
     assert(varDec != NULL);
 
     RecordField* def = VarDecHandler(varDec, inputType);
-    defineVar(def, table, GET_LINENO(root), isField);
+    GET_ENTRY(getVarDecID(varDec)) = defineVar(def, table, GET_LINENO(root), isField);
     return def;
 }
 
@@ -528,17 +686,17 @@ RecordField* VarDecHandler(Node* root, Type* inputType) {
     assert(root->tag == VarDec);
     Node* id, * varDec, * i;
     Type* at;
-    if (PATTERN(root, TOKEN)) {  // ID
+    switch (GET_PROD(root)) {
+    case P_VAR_DEC_ID: // ID
         id = GET_CHILD(root, 0);
-        return makeRecordField(GET_TERMINAL(id, reprS), inputType, NULL);  // isolated node
-    }
-    else if (PATTERN4(root, VarDec, _, TOKEN, _)) { // VarDec [ Int ]
+        return makeRecordField(GET_NAME(id), inputType, NULL);  // isolated node
+    case P_VAR_DEC_ARRAY: // VarDec [ Int ]
         varDec = GET_CHILD(root, 0);
-        i = GET_CHILD(root, 2);
-        at = makeArrayType(makeArray(GET_TERMINAL(i, intLit), inputType));
+        i = GET_CHILD(root, 1);
+        at = makeArrayType(GET_TERMINAL(i, intLit), inputType);
         return VarDecHandler(varDec, at);   // recursively construction
+    default: assert(0);
     }
-    CATCH_ALL
 }
 
 /*
@@ -549,63 +707,64 @@ void FunDecHandler(Node* root, SymbolTable* table, Type* retType, bool isDef) {
     assert(root->tag == FunDec);
     Node* id, * varList;
     RecordField* paramList;
-    char* funcName;
-    if (PATTERN4(root, TOKEN, _, VarList, _)) {
+    Atom funcName;
+    switch (GET_PROD(root)) {
+    case P_FUN_DEC_PARAMS:
         id = GET_CHILD(root, 0);
-        funcName = GET_TERMINAL(id, reprS);
-        varList = GET_CHILD(root, 2);
+        funcName = GET_NAME(id);
+        varList = GET_CHILD(root, 1);
         paramList = VarListHandler(varList, table, isDef);
-    }
-    else if (PATTERN3(root, TOKEN, _, _)) {
+        break;
+    case P_FUN_DEC_EMPTY:
         id = GET_CHILD(root, 0);
-        funcName = GET_TERMINAL(id, reprS);
+        funcName = GET_NAME(id);
         paramList = NULL;
+        break;
+    default: assert(0);
     }
-    CATCH_ALL;
 
-    SymbolTableNode* p;
     // first check the table
-    for (p = *table; p != NULL; p = p->next) {
-        if (p->content->tag == S_FUNC) {
-            if (strcmp(p->content->content.funcDef->name, funcName) == 0) {
-                // if entry with same name found
-                if (isDef && p->content->content.funcDef->defined) {
-                    // def-def conflict
-                    raiseError(4, GET_LINENO(root), "error 4");
-                    return;
-                }
-                // no def-def conflict, check the signature
-                FuncSignature temp;
-                temp.params = paramList;
-                temp.retType = retType;
-                if (sameSignature(temp,
-                    *(p->content->content.funcDef->type->content.func))) {     // if matched
-                    if (isDef) {    // if it is a definition, since there's no conflict
-                        assert(!p->content->content.funcDef->defined);
-                        // define this entry
-                        p->content->content.funcDef->defined = true;
-                        return;
-                    }
-                    else {          // if it is a declaration
-                        return;     // then do nothing
-                    }
-                }
-                else {
-                    raiseError(19, GET_LINENO(root), "error 19");
-                    return;
-                }
+    // a function or a variable of the same name, the latest one decides
+    SymbolTableEntry* func = lookupEntry(*table, S_FUNC, funcName);
+    SymbolTableEntry* e = newerEntry(func, lookupEntry(*table, S_VAR, funcName));
+    if (e != NULL && e == func) {
+        // if entry with same name found
+        if (isDef && func->content.funcDef->defined) {
+            // def-def conflict
+            raiseError(4, GET_LINENO(root), "error 4");
+            return;
+        }
+        // no def-def conflict, check the signature
+        FuncSignature temp;
+        temp.params = paramList;
+        temp.retType = retType;
+        if (sameSignature(temp,
+            *(func->content.funcDef->type->content.func))) {     // if matched
+            if (isDef) {    // if it is a definition, since there's no conflict
+                assert(!func->content.funcDef->defined);
+                // define this entry
+                func->content.funcDef->defined = true;
+                GET_ENTRY(id) = func;
+                return;
+            }
+            else {          // if it is a declaration
+                return;     // then do nothing
             }
         }
-        else if (p->content->tag == S_VAR
-            && strcmp(p->content->content.varDef->name, funcName) == 0) {
-            // this error is not required
-            raiseError(-1, GET_LINENO(root), "additional error");
+        else {
+            raiseError(19, GET_LINENO(root), "error 19");
             return;
         }
     }
+    else if (e != NULL) {
+        // this error is not required
+        raiseError(-1, GET_LINENO(root), "additional error");
+        return;
+    }
     // no previous entry found, then add a new entry
     Type* funcType = makeFuncType(makeFuncSignature(retType, paramList));
-    addEntry(table, makeFuncEntry(makeFunctionEntry(funcName, funcType, isDef, GET_LINENO(root))));
+    GET_ENTRY(id) = makeFuncEntry(makeFunctionEntry(funcName, funcType, isDef, GET_LINENO(root)));
+    addEntry(table, GET_ENTRY(id));
 }
 
 /*
@@ -614,16 +773,16 @@ void FunDecHandler(Node* root, SymbolTable* table, Type* retType, bool isDef) {
 RecordField* VarListHandler(Node* root, SymbolTable* table, bool isDef) {
     assert(root->tag == VarList);
     RecordField* x, * xs;
-    if (PATTERN3(root, ParamDec, _, VarList)) { // recursive case
+    switch (GET_PROD(root)) {
+    case P_VAR_LIST_CONS: // recursive case
         x = ParamDecHandler(GET_CHILD(root, 0), table, isDef);
-        xs = VarListHandler(GET_CHILD(root, 2), table, isDef);
+        xs = VarListHandler(GET_CHILD(root, 1), table, isDef);
         x->next = xs;
         return x;
-    }
-    else if (PATTERN(root, ParamDec)) {         // base case
+    case P_VAR_LIST: // base case
         return ParamDecHandler(GET_CHILD(root, 0), table, isDef);
+    default: assert(0);
     }
-    CATCH_ALL
 }
 
 /*
@@ -635,18 +794,19 @@ RecordField* ParamDecHandler(Node* root, SymbolTable* table, bool isDef) {
     Node* specifier, * varDec;
     Type* t;
     RecordField* field;
-    if (PATTERN2(root, Specifier, VarDec)) {
+    switch (GET_PROD(root)) {
+    case P_PARAM_DEC:
         specifier = GET_CHILD(root, 0);
         varDec = GET_CHILD(root, 1);
         // FIXME: side effect here
         t = SpecifierHandler(specifier, table);
         field = VarDecHandler(varDec, t);
         if (isDef) {
-            defineVar(field, table, GET_LINENO(root), false);
+            GET_ENTRY(getVarDecID(varDec)) = defineVar(field, table, GET_LINENO(root), false);
         }
         return field;
+    default: assert(0);
     }
-    CATCH_ALL
 }
 
 /*
@@ -655,13 +815,16 @@ RecordField* ParamDecHandler(Node* root, SymbolTable* table, bool isDef) {
  */
 void CompStHandler(Node* root, SymbolTable* table, Type* retType) {
     assert(root->tag == CompSt);
-    if (root->content.nonterminal.childNum == 4) {   // { DefList StmtList }
-    // if (PATTERN4(root, _, DefList, StmtList, _)) {
+    switch (GET_PROD(root)) {
+    case P_COMP_ST: // { DefList StmtList }
+    {
         bool waste;
-        DefListHandler(GET_CHILD(root, 1), table, &waste, false);
-        StmtListHandler(GET_CHILD(root, 2), table, retType);
+        DefListHandler(GET_CHILD(root, 0), table, &waste, false);
+        StmtListHandler(GET_CHILD(root, 1), table, retType);
+        break;
+    }
+    default: assert(0);
     }
-    CATCH_ALL
 }
 
 void StmtListHandler(Node* root, SymbolTable* table, Type* retType) {
@@ -673,33 +836,40 @@ void StmtListHandler(Node* root, SymbolTable* table, Type* retType) {
 
 void StmtHandler(Node* root, SymbolTable* table, Type* retType) {
     assert(root->tag == Stmt);
-    if (PATTERN2(root, Exp, _)) {        // Exp;
+    switch (GET_PROD(root)) {
+    case P_STMT_EXP: // Exp;
+    {
         // check the expression
         Type* t = ExpHandler(GET_CHILD(root, 0), *table);
-        deleteType(t);
+        break;
     }
-    else if (PATTERN(root, CompSt)) {
+    case P_STMT_COMP_ST:
         CompStHandler(GET_CHILD(root, 0), table, retType);
-    }
-    else if (PATTERN3(root, _, Exp, _)) {    // return Exp;
-        Type* t = ExpHandler(GET_CHILD(root, 1), *table);
+        break;
+    case P_STMT_RETURN: // return Exp;
+    {
+        Type* t = ExpHandler(GET_CHILD(root, 0), *table);
         if (t != NULL && !typeEqual(t, retType)) {
             raiseError(8, GET_LINENO(root), "error 8");
         }
-        deleteType(t);
+        break;
+    }
+    case P_STMT_IF:
+    case P_STMT_WHILE: // if(Exp) Stmt || while(Exp) Stmt
+    {
+        Type* t = ExpHandler(GET_CHILD(root, 0), *table);
+        StmtHandler(GET_CHILD(root, 1), table, retType);
+        break;
     }
-    else if (PATTERN5(root, _, _, Exp, _, Stmt)) {   // if(Exp) Stmt || while(Exp) Stmt
-        Type* t = ExpHandler(GET_CHILD(root, 2), *table);
-        StmtHandler(GET_CHILD(root, 4), table, retType);
-        deleteType(t);
+    case P_STMT_IF_ELSE: // if(Exp) Stmt else Stmt
+    {
+        Type* t = ExpHandler(GET_CHILD(root, 0), *table);
+        StmtHandler(GET_CHILD(root, 1), table, retType);
+        StmtHandler(GET_CHILD(root, 2), table, retType);
+        break;
     }
-    else if (PATTERN7(root, _, _, Exp, _, Stmt, _, Stmt)) {  // if(Exp) Stmt else Stmt
-        Type* t = ExpHandler(GET_CHILD(root, 2), *table);
-        StmtHandler(GET_CHILD(root, 4), table, retType);
-        StmtHandler(GET_CHILD(root, 6), table, retType);
-        deleteType(t);
+    default: assert(0);
     }
-    CATCH_ALL
 }
 
 /*
@@ -707,35 +877,42 @@ void StmtHandler(Node* root, SymbolTable* table, Type* retType) {
  */
 bool isLValue(Node* exp) {
     assert(exp->tag == Exp);
-    if (PATTERN(exp, _)) {
-        return GET_CHILD(exp, 0)->content.terminal->tag == ID;
-    }
-    else if (PATTERN4(exp, Exp, _, Exp, _)) {
-        return true;
-    }
-    else if (PATTERN3(exp, Exp, _, _)) {
+    switch (GET_PROD(exp)) {
+    case P_EXP_ID: case P_EXP_INDEX: case P_EXP_FIELD:
         return true;
+    default:
+        return false;
     }
-    return false;
 }
 
-// TODO: make sure that all sub exprs are visited
+static Type* checkExp(Node* root, SymbolTable table);
+
 /*
  * @Nullable, for error case
- * pure, for type checking
  * return type of the expression if checked
+ * the type is also kept on the node, so the later phases never check it again
  */
 Type* ExpHandler(Node* root, SymbolTable table) {
     assert(root->tag == Exp);
-    if (PATTERN3(root, Exp, _, Exp)) {       // binary
+    Type* t = checkExp(root, table);
+    GET_TYPE(root) = t;
+    return t;
+}
+
+// TODO: make sure that all sub exprs are visited
+static Type* checkExp(Node* root, SymbolTable table) {
+    switch (GET_PROD(root)) {
+    case P_EXP_ASSIGN: case P_EXP_AND: case P_EXP_OR: case P_EXP_RELOP:
+    case P_EXP_PLUS: case P_EXP_MINUS: case P_EXP_STAR: case P_EXP_DIV:
+    {   // binary
         Type* t1 = ExpHandler(GET_CHILD(root, 0), table);
-        Type* t2 = ExpHandler(GET_CHILD(root, 2), table);
+        Type* t2 = ExpHandler(GET_CHILD(root, 1), table);
         if (t1 == NULL || t2 == NULL) {
             // TODO: does it need to be an error here?
             return NULL;    // just a Maybe Monad
         }
-        switch (GET_CHILD(root, 1)->content.terminal->tag) {
-        case ASSIGNOP:
+        switch (GET_PROD(root)) {
+        case P_EXP_ASSIGN:
             // check if the lhs is lval
             if (!isLValue(GET_CHILD(root, 0))) {
                 raiseError(6, GET_LINENO(root), "error 6");
@@ -743,7 +920,6 @@ Type* ExpHandler(Node* root, SymbolTable table) {
             }
             // match type
             if (typeEqual(t1, t2)) {
-                deleteType(t1);
                 return t2;
             }
             else {
@@ -751,30 +927,26 @@ Type* ExpHandler(Node* root, SymbolTable table) {
                 goto assignErr;
             }
         assignErr:
-            deleteType(t1); deleteType(t2);
             return NULL;
-        case AND: case OR:
+        case P_EXP_AND: case P_EXP_OR:
             // logic expr is only for int
             if (t1->tag == PRIMITIVE && t2->tag == PRIMITIVE
                 && t1->content.primitive == T_INT && t2->content.primitive == T_INT) {
-                deleteType(t1); deleteType(t2);
                 return makePrimitiveType(T_INT);
             }
             break;
-        case RELOP:
+        case P_EXP_RELOP:
             // relation operators, only for int-int or float-float
             // but returns int
             if (t1->tag == PRIMITIVE && t2->tag == PRIMITIVE
                 && t1->content.primitive == t2->content.primitive) {
-                deleteType(t1); deleteType(t2);
                 return makePrimitiveType(T_INT);
             }
             break;
-        case PLUS: case MINUS: case STAR: case DIV:
+        case P_EXP_PLUS: case P_EXP_MINUS: case P_EXP_STAR: case P_EXP_DIV:
             // arithmetic operators, only for int-int or float-float
             if (t1->tag == PRIMITIVE && t2->tag == PRIMITIVE
                 && t1->content.primitive == t2->content.primitive) {
-                deleteType(t1); deleteType(t2);
                 return makePrimitiveType(t1->content.primitive);
             }
             break;
@@ -782,26 +954,46 @@ Type* ExpHandler(Node* root, SymbolTable table) {
             assert(0);
         }
         // oprand type not matched
-        deleteType(t1); deleteType(t2);
         raiseError(7, GET_LINENO(root), "error 7");
         return NULL;
     }
-    else if (PATTERN3(root, _, Exp, _)) {    // (Exp)
+    case P_EXP_PAREN:   // (Exp)
         // no additional checking
-        return ExpHandler(GET_CHILD(root, 1), table);
+        return ExpHandler(GET_CHILD(root, 0), table);
+    case P_EXP_CALL_EMPTY:  // ID()
+    {
+        Type* t = IDHandler(GET_CHILD(root, 0), table, ID_FUNC, GET_LINENO(root));
+        if (t == NULL) {
+            return NULL;
+        }
+        // check signature
+        if (t->tag == FUNC) {
+            if (t->content.func->params == NULL) {
+                return t->content.func->retType;
+            }
+            else {
+                raiseError(9, GET_LINENO(root), "error 9");
+                return NULL;
+            }
+        }
+        else {
+            raiseError(11, GET_LINENO(root), "error 11");
+            return NULL;
+        }
     }
-    else if (PATTERN2(root, _, Exp)) {       // -Exp & !Exp
-        Type* t = ExpHandler(GET_CHILD(root, 1), table);
+    case P_EXP_NEG: case P_EXP_NOT:     // -Exp & !Exp
+    {
+        Type* t = ExpHandler(GET_CHILD(root, 0), table);
         if (t == NULL) {
             return NULL;
         }
-        switch (GET_CHILD(root, 0)->content.terminal->tag) {
-        case MINUS:
+        switch (GET_PROD(root)) {
+        case P_EXP_NEG:
             if (t->tag == PRIMITIVE) {
                 return t;
             }
             break;
-        case NOT:
+        case P_EXP_NOT:
             if (t->tag == PRIMITIVE && t->content.primitive == T_INT) {
                 return t;
             }
@@ -809,13 +1001,13 @@ Type* ExpHandler(Node* root, SymbolTable table) {
         default:
             assert(0);
         }
-        deleteType(t);
         raiseError(7, GET_LINENO(root), "error 7");
         return NULL;
     }
-    else if (PATTERN4(root, _, _, Args, _)) {    // ID(Args)
+    case P_EXP_CALL:    // ID(Args)
+    {
         Type* t = IDHandler(GET_CHILD(root, 0), table, ID_FUNC, GET_LINENO(root));
-        RecordField* args = ArgsHandler(GET_CHILD(root, 2), table);
+        RecordField* args = ArgsHandler(GET_CHILD(root, 1), table);
         if (t == NULL || args == NULL) {
             goto callArgsErr;
         }
@@ -835,9 +1027,7 @@ Type* ExpHandler(Node* root, SymbolTable table) {
                     }
                 }
                 if (a == NULL && p == NULL) {
-                    deleteType(t);
-                    // TODO: delete args
-                    return cloneType(t->content.func->retType);
+                    return t->content.func->retType;
                 }
                 else {
                     raiseError(9, GET_LINENO(root), "error 9");
@@ -850,89 +1040,57 @@ Type* ExpHandler(Node* root, SymbolTable table) {
             goto callArgsErr;
         }
     callArgsErr:
-        deleteType(t);
         return NULL;
     }
-    else if (PATTERN3(root, _, _, _)) {      // ID()
-        Type* t = IDHandler(GET_CHILD(root, 0), table, ID_FUNC, GET_LINENO(root));
-        if (t == NULL) {
-            return NULL;
-        }
-        // check signature
-        if (t->tag == FUNC) {
-            if (t->content.func->params == NULL) {
-                Type* retType = cloneType(t->content.func->retType);
-                deleteType(t);
-                return retType;
-            }
-            else {
-                deleteType(t);
-                raiseError(9, GET_LINENO(root), "error 9");
-                return NULL;
-            }
-        }
-        else {
-            deleteType(t);
-            raiseError(11, GET_LINENO(root), "error 11");
-            return NULL;
-        }
-    }
-    else if (PATTERN4(root, Exp, _, Exp, _)) {   // Exp[Exp]
+    case P_EXP_INDEX:   // Exp[Exp]
+    {
         Type* t1 = ExpHandler(GET_CHILD(root, 0), table);
-        Type* t2 = ExpHandler(GET_CHILD(root, 2), table);
+        Type* t2 = ExpHandler(GET_CHILD(root, 1), table);
         if (t1 == NULL || t2 == NULL) {
             return NULL;
         }
         if (t1->tag == ARRAY) {
             if (t2->tag == PRIMITIVE && t2->content.primitive == T_INT) {
-                Type* retType = cloneType(t1->content.array->type);
-                deleteType(t1); deleteType(t2);
-                return retType;
+                return t1->content.array->type;
             }
             else {
-                deleteType(t1); deleteType(t2);
                 raiseError(12, GET_LINENO(root), "error 12");
                 return NULL;
             }
         }
         else {
-            deleteType(t1); deleteType(t2);
             raiseError(10, GET_LINENO(root), "error 10");
             return NULL;
         }
     }
-    else if (PATTERN3(root, Exp, _, _)) {    // Exp.ID
+    case P_EXP_FIELD:   // Exp.ID
+    {
         Type* t1 = ExpHandler(GET_CHILD(root, 0), table);
         if (t1 == NULL) {
             return NULL;
         }
         if (t1->tag == RECORD) {
-            Type* t2 = IDRecHandler(GET_CHILD(root, 2), t1->content.record, GET_LINENO(root));
+            Type* t2 = IDRecHandler(GET_CHILD(root, 1), t1->content.record, GET_LINENO(root));
             if (t2 == NULL) {
                 return NULL;
             }
             return t2;
         }
         else {
-            deleteType(t1);
             raiseError(13, GET_LINENO(root), "error 13");
             return NULL;
         }
     }
-    else if (PATTERN(root, TOKEN)) {         // lit & id, base case
-        Node* token = GET_CHILD(root, 0);
-        switch (token->content.terminal->tag) {
-        case ID:
-            return IDHandler(token, table, ID_VAR, GET_LINENO(root));
-        case INT:
-            return makePrimitiveType(T_INT);
-        case FLOAT:
-            return makePrimitiveType(T_FLOAT);
-        default:
-            assert(0);
-        }
+    // lit & id, base case
+    case P_EXP_ID:
+        return IDHandler(GET_CHILD(root, 0), table, ID_VAR, GET_LINENO(root));
+    case P_EXP_INT:
+        return makePrimitiveType(T_INT);
+    case P_EXP_FLOAT:
+        return makePrimitiveType(T_FLOAT);
+    default: assert(0);
     }
-    CATCH_ALL
+    return NULL;
 }
 
 /*
@@ -940,28 +1098,16 @@ Type* ExpHandler(Node* root, SymbolTable table) {
  * quite special one, for ID (in expressions)
  */
 Type* IDHandler(Node* root, SymbolTable table, enum IDKind kind, int lineNo) {
-    assert(root->tag == TOKEN && root->content.terminal->tag == ID);
+    assert(root->tag == TOKEN && root->content.terminal.tag == ID);
     assert(kind == ID_VAR || kind == ID_FUNC);
-    SymbolTableNode* p;
     /* lookup the table and return the type */
-    for (p = table; p != NULL; p = p->next) {
-        switch (p->content->tag) {
-        case S_VAR:
-            if (strcmp(p->content->content.varDef->name,
-                GET_TERMINAL(root, reprS)) == 0) {
-                return cloneType(p->content->content.varDef->type);
-            }
-            break;
-        case S_FUNC:
-            if (strcmp(p->content->content.funcDef->name,
-                GET_TERMINAL(root, reprS)) == 0) {
-                return cloneType(p->content->content.funcDef->type);
-            }
-            break;
-        default:
-            continue;   // skip the structure since it's a type
-            // TODO: what if the var name is same as struct name?
-        }
+    // the structures are skipped since they are types
+    // TODO: what if the var name is same as struct name?
+    SymbolTableEntry* e = newerEntry(lookupEntry(table, S_VAR, GET_NAME(root)),
+        lookupEntry(table, S_FUNC, GET_NAME(root)));
+    GET_ENTRY(root) = e;
+    if (e != NULL) {
+        return e->tag == S_VAR ? e->content.varDef->type : e->content.funcDef->type;
     }
     // not found, raise error
     switch (kind) {
@@ -983,11 +1129,12 @@ Type* IDHandler(Node* root, SymbolTable table, enum IDKind kind, int lineNo) {
  * for structures
  */
 Type* IDRecHandler(Node* root, Record* record, int lineNo) {
-    assert(root->tag == TOKEN && root->content.terminal->tag == ID);
+    assert(root->tag == TOKEN && root->content.terminal.tag == ID);
     RecordField* p;
     for (p = record->fieldList; p != NULL; p = p->next) {
-        if (strcmp(p->name, GET_TERMINAL(root, reprS)) == 0) {
-            return cloneType(p->type);
+        if (p->name == GET_NAME(root)) {
+            GET_FIELD(root) = p;
+            return p->type;
         }
     }
     raiseError(14, lineNo, "error 14");
@@ -1000,7 +1147,9 @@ Type* IDRecHandler(Node* root, Record* record, int lineNo) {
  */
 RecordField* ArgsHandler(Node* root, SymbolTable table) {
     assert(root->tag == Args);
-    if (PATTERN(root, Exp)) {
+    switch (GET_PROD(root)) {
+    case P_ARGS:
+    {
         Type* t = ExpHandler(GET_CHILD(root, 0), table);
         if (t == NULL) {
             return NULL;
@@ -1010,14 +1159,15 @@ RecordField* ArgsHandler(Node* root, SymbolTable table) {
             return makeRecordField(NULL, t, NULL);
         }
     }
-    else if (PATTERN3(root, Exp, _, Args)) {
+    case P_ARGS_CONS:
+    {
         // assert(0);
         Type* t = ExpHandler(GET_CHILD(root, 0), table);
         if (t == NULL) {
             return NULL;
         }
         else {
-            RecordField* xs = ArgsHandler(GET_CHILD(root, 2), table);
+            RecordField* xs = ArgsHandler(GET_CHILD(root, 1), table);
             if (xs == NULL) {
                 return NULL;
             }
@@ -1027,7 +1177,8 @@ RecordField* ArgsHandler(Node* root, SymbolTable table) {
             }
         }
     }
-    CATCH_ALL
+    default: assert(0);
+    }
 }
 
 /* print symbol table, for debugging */
@@ -1115,9 +1266,10 @@ void printSymbolTableNode(SymbolTableNode* node) {
 
 }
 void printSymbolTable(SymbolTable t) {
+    SymbolTableNode* p;
     printf("-------------------\n");
-    for (; t != NULL; t = t->next) {
-        printSymbolTableNode(t);
+    for (p = t->newest; p != NULL; p = p->older) {
+        printSymbolTableNode(p);
         printf("-------------------\n");
     }
 }
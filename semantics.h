@@ -2,28 +2,43 @@
 #define SEMANTICS_H
 
 #include "common.h"
+#include "atom.h"
 
-extern bool semanticsError;
+// whether the program of the thread has a semantic error
+extern _Thread_local bool semanticsError;
 enum IDKind { ID_VAR, ID_FIELD, ID_FUNC };
 
 /* Type definitions */
 struct Type;
 
 typedef struct RecordField {
-    char* name;                 // name of the field
+    Atom name;                  // name of the field
     struct Type* type;          // type of the field
     struct RecordField* next;   // linked list
+    int offset;                 // the bytes from the start of the record, for the fields of a record
 } RecordField;
 
+/* the layout of a record is computed once when it is made, the sizes are -1 when they are unknown */
 typedef struct Record {     // for structures
-    char* name;             // all record types have a name
+    Atom name;              // all record types have a name
                             // for anonymous records, this field is NULL
     RecordField* fieldList; // a List of fields
+    int byteSize;           // the bytes of the whole record, a multiple of `align`
+    int align;              // the largest alignment of the fields
 } Record;
 
+/*
+ * an array of `size` elements of `type`, with its layout computed once when the type is made
+ * the dimensions are counted from the outermost one, e.g. `int a[2][3]` has extents {2, 3}
+ * and strides {12, 4}, the sizes are -1 when they are unknown
+ */
 typedef struct Array {
     int size;
     struct Type* type;
+    int rank;           // the number of the dimensions
+    int* extents;       // the number of the elements in each dimension
+    int* strides;       // the bytes between two adjacent indexes of each dimension
+    int byteSize;       // the bytes of the whole array
 } Array;
 
 typedef struct FuncSignature {
@@ -31,6 +46,7 @@ typedef struct FuncSignature {
     RecordField* params;
 } FuncSignature;
 
+/* the types are immutable and shared, see `makeArrayType` */
 typedef struct Type {
     enum { PRIMITIVE, RECORD, ARRAY, FUNC } tag;
     union {
@@ -39,6 +55,7 @@ typedef struct Type {
         Array* array;               // for arrays
         FuncSignature* func;        // for functions
     } content;
+    struct Type* equiv;     // the class of the equal types, NULL if it equals no type
 } Type;
 
 /* Symbol table definitions */
@@ -51,15 +68,16 @@ enum SymbolTag {
 };
 
 typedef struct NameTypePair {
-    char* name;
+    Atom name;
     Type* type;
 } NameTypePair;
 
 typedef struct FunctionEntry {
-    char* name;
+    Atom name;
     Type* type;
     bool defined;   // if the function has been defined
     int decLineNo;  // the line number of the first declaration
+    int localNum;   // the number of the parameters & local variables of the definition
 } FunctionEntry;
 
 typedef struct SymbolTableEntry {
@@ -70,22 +88,46 @@ typedef struct SymbolTableEntry {
         FunctionEntry* funcDef;      // for function def & dec
         // TODO:...
     } content;
+    int order;      // the entries are numbered in the order they are defined
+    int local;      // for a parameter or a local variable, its dense index in the function
+                    // the parameters go first, -1 for the other entries
 } SymbolTableEntry;
 
+/*
+ * the symbol table is a hash table of bindings keyed by the namespace (the tag) and the name
+ * structures, fields, variables and functions are in different namespaces
+ * the language has a single global scope, so every binding lives as long as the table
+ * the bindings of a bucket are chained from the newest one, so a lookup finds the last definition first
+ */
 typedef struct SymbolTableNode {
     struct SymbolTableEntry* content;
-    struct SymbolTableNode* next;
+    Atom name;
+    struct SymbolTableNode* next;       // the next binding in the same bucket
+    struct SymbolTableNode* older;      // the binding defined before, for going through all of them
 } SymbolTableNode;
 
-typedef struct SymbolTableNode* SymbolTable;
+typedef struct SymbolHashTable {
+    SymbolTableNode** buckets;
+    unsigned bucketNum;         // always a power of 2
+    int size;                   // the number of the entries defined
+    SymbolTableNode* newest;    // all the bindings, from the newest to the oldest
+} SymbolHashTable;
 
-Type* cloneType(Type* t);
-RecordField* cloneFieldList(RecordField* rf);
+typedef struct SymbolHashTable* SymbolTable;
+
+SymbolTable makeSymbolTable();
+void addEntry(SymbolTable* table, SymbolTableEntry* newEntry);
+// the last entry of the name in the namespace, NULL if there is none
+SymbolTableEntry* lookupEntry(SymbolTable table, enum SymbolTag tag, Atom name);
+
+Type* makePrimitiveType(enum PrimTypeTag primitive);
+Type* makeArrayType(int size, Type* type);
+Type* makeRecordType(Record* record);
+bool typeEqual(Type* t1, Type* t2);
 SymbolTable getSymbleTable(Node* parseTree);
 
-Record* makeRecord(char* name, RecordField* fieldList);
-Array* makeArray(int size, Type* type);
-FunctionEntry* makeFunctionEntry(char* name, Type* t, bool defined, int lineNo);
+Record* makeRecord(Atom name, RecordField* fieldList);
+FunctionEntry* makeFunctionEntry(Atom name, Type* t, bool defined, int lineNo);
 FuncSignature* makeFuncSignature(Type* retType, RecordField* params);
 
 void ExtDefListHandler(Node* root, SymbolTable* table);
@@ -98,6 +140,8 @@ RecordField* DefHandler(Node* root, SymbolTable* table, bool* containsExp, bool
 RecordField* DecListHandler(Node* root, SymbolTable* table, Type* inputType, bool* containsExp, bool isField);
 RecordField* DecHandler(Node* root, SymbolTable* table, Type* inputType, bool* containsExp, bool isField);
 RecordField* VarDecHandler(Node* root, Type* inputType);
+// the ID node a VarDec declares
+Node* getVarDecID(Node* root);
 
 void FunDecHandler(Node* root, SymbolTable* table, Type* retType, bool isDef);
 RecordField* VarListHandler(Node* root, SymbolTable* table, bool isDef);
@@ -0,0 +1,81 @@
+#define _DEFAULT_SOURCE
+#include "source.h"
+#include<fcntl.h>
+#include<stdio.h>
+#include<stdlib.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+
+// map the file with its sentinels, the file is mapped over an anonymous region
+// so the bytes after the end of file are always zero-filled
+// even when the file size is a multiple of the page size
+static bool mapSource(SourceFile* src, int fd, size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t mapSize = (size + 2 + page - 1) / page * page;
+    char* base = (char*)mmap(NULL, mapSize, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) { return false; }
+    // the mapping is private and writable, since the scanner terminates tokens in place
+    if (mmap(base, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, mapSize);
+        return false;
+    }
+    src->text = base;
+    src->size = size;
+    src->mapSize = mapSize;
+    return true;
+}
+
+// the fallback for the files that can not be mapped, e.g. pipes & empty files
+static bool readSource(SourceFile* src, int fd) {
+    size_t cap = 4096, size = 0;
+    char* text = (char*)malloc(cap);
+    for (;;) {
+        // two bytes are always kept for the sentinels, so a read never asks for nothing
+        if (cap - size <= 2) {
+            cap *= 2;
+            text = (char*)realloc(text, cap);
+        }
+        ssize_t n = read(fd, text + size, cap - size - 2);
+        if (n < 0) {
+            free(text);
+            return false;
+        }
+        if (n == 0) { break; }
+        size += (size_t)n;
+    }
+    text[size] = text[size + 1] = '\0';
+    src->text = text;
+    src->size = size;
+    src->mapSize = 0;
+    return true;
+}
+
+bool openSource(SourceFile* src, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { return false; }
+    struct stat st;
+    bool ok = false;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        ok = mapSource(src, fd, (size_t)st.st_size);
+    }
+    if (!ok) {
+        ok = readSource(src, fd);
+    }
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+    return ok;
+}
+
+void closeSource(SourceFile* src) {
+    if (src->mapSize != 0) {
+        munmap(src->text, src->mapSize);
+    }
+    else {
+        free(src->text);
+    }
+    src->text = NULL;
+    src->size = 0;
+    src->mapSize = 0;
+}
@@ -0,0 +1,28 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include "common.h"
+#include <stddef.h>
+
+/*
+ * the whole source file, kept in memory for the lifetime of a compilation
+ * the text is mapped into memory when possible, and read into the heap otherwise
+ * it is always followed by two NUL bytes, which are the end-of-buffer
+ * sentinels required by the scanner
+ */
+typedef struct SourceFile {
+    char* text;
+    size_t size;        // the length of the source, without the sentinels
+    size_t mapSize;     // the length of the mapping, 0 when the text is on the heap
+} SourceFile;
+
+/* a piece of the source text, tokens refer to their spellings with it */
+typedef struct Slice {
+    int offset;
+    int length;
+} Slice;
+
+bool openSource(SourceFile* src, const char* path);
+void closeSource(SourceFile* src);
+
+#endif
@@ -0,0 +1,426 @@
+#include "ssa.h"
+#include "dom.h"
+#include "dataflow.h"
+#include "coalesce.h"
+#include<assert.h>
+#include<stdlib.h>
+
+int firstNonPhi(const BasicBlock* b) {
+    int k = 0;
+    if (k < b->instNum && b->insts[k].tag == I_LABEL) { k++; }
+    while (k < b->instNum && b->insts[k].tag == I_PHI) { k++; }
+    return k;
+}
+
+// the phi of `v` with an arg from each reachable predecessor, which reads `v` until it is renamed
+static void insertPhi(CFG* cfg, int b, int v) {
+    BasicBlock* block = &cfg->blocks[b];
+    PhiArg* args = (PhiArg*)arenaAlloc(currentArena, (block->predNum + 1) * sizeof(PhiArg));
+    int n = 0, k;
+    for (k = 0; k < block->predNum; k++) {
+        if (cfg->blocks[block->preds[k]].rpo < 0) { continue; }
+        args[n].pred = block->preds[k];
+        args[n].value = makeVarOp(v);
+        n++;
+    }
+    insertInst(block, firstNonPhi(block), makeTernaryInst(I_PHI, makeVarOp(v), makePhiOp(args), makeLitOp(n)));
+}
+
+// the vregs of the arrays, which are never renamed
+static bool* findMemVregs(const CFG* cfg) {
+    bool* isMem = (bool*)calloc(cfg->func->vregNum + 1, sizeof(bool));
+    int b, k;
+    for (b = 0; b < cfg->blockNum; b++) {
+        const BasicBlock* block = &cfg->blocks[b];
+        for (k = 0; k < block->instNum; k++) {
+            if (block->insts[k].tag == I_DEC) { isMem[block->insts[k].addrs[0].content.vreg] = true; }
+        }
+    }
+    return isMem;
+}
+
+static void placePhis(CFG* cfg, const Dominators* dom, const Liveness* lv, const bool* isMem) {
+    const NonLocals* nl = &lv->nl;
+    int n = cfg->blockNum, pos, k, j, bit;
+    // the blocks defining each non-local, as lists in one block of memory
+    int* defNum = (int*)calloc(nl->num + 1, sizeof(int));
+    int* lastBlock = (int*)malloc((nl->num + 1) * sizeof(int));
+    int total = 0;
+    for (bit = 0; bit < nl->num; bit++) { lastBlock[bit] = -1; }
+    for (pos = 0; pos < cfg->orderNum; pos++) {
+        int b = cfg->order[pos];
+        const BasicBlock* block = &cfg->blocks[b];
+        for (k = 0; k < block->instNum; k++) {
+            int d = instDef(&block->insts[k]);
+            if (d < 0 || nl->bitOf[d] < 0 || isMem[d] || lastBlock[nl->bitOf[d]] == b) { continue; }
+            lastBlock[nl->bitOf[d]] = b;
+            defNum[nl->bitOf[d]]++;
+            total++;
+        }
+    }
+    int* defStart = (int*)malloc((nl->num + 1) * sizeof(int));
+    int* defBlocks = (int*)malloc((total + 1) * sizeof(int));
+    total = 0;
+    for (bit = 0; bit < nl->num; bit++) {
+        defStart[bit] = total;
+        total += defNum[bit];
+        defNum[bit] = 0;
+        lastBlock[bit] = -1;
+    }
+    for (pos = 0; pos < cfg->orderNum; pos++) {
+        int b = cfg->order[pos];
+        const BasicBlock* block = &cfg->blocks[b];
+        for (k = 0; k < block->instNum; k++) {
+            int d = instDef(&block->insts[k]);
+            if (d < 0 || nl->bitOf[d] < 0 || isMem[d] || lastBlock[nl->bitOf[d]] == b) { continue; }
+            bit = nl->bitOf[d];
+            lastBlock[bit] = b;
+            defBlocks[defStart[bit] + defNum[bit]++] = b;
+        }
+    }
+
+    // the iterated frontiers, with a phi only where the vreg is live
+    int* hasPhi = (int*)malloc((n + 1) * sizeof(int));
+    int* inWork = (int*)malloc((n + 1) * sizeof(int));
+    int* work = (int*)malloc((n + 1) * sizeof(int));
+    for (k = 0; k < n; k++) { hasPhi[k] = inWork[k] = -1; }
+    for (bit = 0; bit < nl->num; bit++) {
+        int top = 0;
+        for (k = 0; k < defNum[bit]; k++) {
+            int b = defBlocks[defStart[bit] + k];
+            inWork[b] = bit;
+            work[top++] = b;
+        }
+        while (top > 0) {
+            int b = work[--top];
+            for (j = 0; j < dom->frontierNum[b]; j++) {
+                int f = dom->frontier[b][j];
+                if (hasPhi[f] == bit) { continue; }
+                hasPhi[f] = bit;
+                if (bitTest(lv->df->in[f], bit)) { insertPhi(cfg, f, nl->vregOf[bit]); }
+                if (inWork[f] != bit) {
+                    inWork[f] = bit;
+                    work[top++] = f;
+                }
+            }
+        }
+    }
+    free(defNum);
+    free(lastBlock);
+    free(defStart);
+    free(defBlocks);
+    free(hasPhi);
+    free(inWork);
+    free(work);
+}
+
+/*
+ * the current name of each old vreg is kept in `cur`, and the changes are logged,
+ * so they can be undone when the walk leaves the subtree of the block making them
+ */
+typedef struct Renamer {
+    IRFunction* func;
+    const bool* isMem;
+    int* cur;
+    bool* claimed;      // whether an old name is already taken by a definition
+    SSAForm* ssa;
+    int* logVar;
+    int* logOld;
+    int logTop, logCap;
+} Renamer;
+
+static void renameDef(Renamer* r, Oprand* op) {
+    int v = op->content.vreg;
+    if (r->isMem[v]) { return; }
+    int name = v;
+    if (r->claimed[v]) {
+        SSAForm* ssa = r->ssa;
+        name = newFuncVreg(r->func);
+        if (name >= ssa->cap) {
+            ssa->cap = ssa->cap * 2 > name ? ssa->cap * 2 : name + 1;
+            ssa->origin = (int*)realloc(ssa->origin, ssa->cap * sizeof(int));
+        }
+        ssa->origin[name] = v;
+        ssa->num = name + 1;
+    }
+    r->claimed[v] = true;
+    if (r->logTop == r->logCap) {
+        r->logCap = r->logCap == 0 ? 64 : r->logCap * 2;
+        r->logVar = (int*)realloc(r->logVar, r->logCap * sizeof(int));
+        r->logOld = (int*)realloc(r->logOld, r->logCap * sizeof(int));
+    }
+    r->logVar[r->logTop] = v;
+    r->logOld[r->logTop] = r->cur[v];
+    r->logTop++;
+    r->cur[v] = name;
+    op->content.vreg = name;
+}
+
+static void renameBlock(CFG* cfg, Renamer* r, int b) {
+    BasicBlock* block = &cfg->blocks[b];
+    int k, j, s;
+    for (k = 0; k < block->instNum; k++) {
+        Instruction* i = &block->insts[k];
+        int slots[3];
+        int n = useSlots(i, slots);
+        for (j = 0; j < n; j++) {
+            Oprand* op = &i->addrs[slots[j]];
+            op->content.vreg = r->cur[op->content.vreg];
+        }
+        if (instDef(i) >= 0) { renameDef(r, &i->addrs[0]); }
+    }
+    // the args of the phis in the successors, which still hold the old names
+    for (s = 0; s < block->succNum; s++) {
+        BasicBlock* succ = &cfg->blocks[block->succs[s]];
+        int end = firstNonPhi(succ);
+        for (k = 0; k < end; k++) {
+            Instruction* i = &succ->insts[k];
+            if (i->tag != I_PHI) { continue; }
+            PhiArg* args = i->addrs[1].content.args;
+            for (j = 0; j < i->addrs[2].content.lit; j++) {
+                if (args[j].pred == b) { args[j].value.content.vreg = r->cur[args[j].value.content.vreg]; }
+            }
+        }
+    }
+}
+
+// a walk of the dominator tree with an explicit stack, a block is pushed again as `~b` to be left
+static void renameVregs(CFG* cfg, const Dominators* dom, const bool* isMem, SSAForm* ssa) {
+    int n = cfg->blockNum, vregNum = cfg->func->vregNum, k;
+    Renamer r;
+    r.func = cfg->func;
+    r.isMem = isMem;
+    r.ssa = ssa;
+    r.cur = (int*)malloc((vregNum + 1) * sizeof(int));
+    r.claimed = (bool*)calloc(vregNum + 1, sizeof(bool));
+    for (k = 0; k < vregNum; k++) { r.cur[k] = k; }
+    r.logVar = r.logOld = NULL;
+    r.logTop = r.logCap = 0;
+
+    int* stack = (int*)malloc((2 * n + 1) * sizeof(int));
+    int* height = (int*)malloc((n + 1) * sizeof(int));
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        int x = stack[--top];
+        if (x < 0) {
+            int b = ~x;
+            while (r.logTop > height[b]) {
+                r.logTop--;
+                r.cur[r.logVar[r.logTop]] = r.logOld[r.logTop];
+            }
+            continue;
+        }
+        height[x] = r.logTop;
+        renameBlock(cfg, &r, x);
+        stack[top++] = ~x;
+        for (k = dom->childNum[x] - 1; k >= 0; k--) { stack[top++] = dom->children[x][k]; }
+    }
+    free(stack);
+    free(height);
+    free(r.cur);
+    free(r.claimed);
+    free(r.logVar);
+    free(r.logOld);
+}
+
+SSAForm* buildSSA(CFG* cfg) {
+    Liveness* lv = analyzeLiveness(cfg);
+    Dominators* dom = computeDominators(cfg);
+    bool* isMem = findMemVregs(cfg);
+    SSAForm* ssa = (SSAForm*)malloc(sizeof(SSAForm));
+    int k;
+    ssa->num = ssa->cap = cfg->func->vregNum;
+    ssa->origin = (int*)malloc((ssa->cap + 1) * sizeof(int));
+    for (k = 0; k < ssa->num; k++) { ssa->origin[k] = k; }
+    placePhis(cfg, dom, lv, isMem);
+    renameVregs(cfg, dom, isMem, ssa);
+    free(isMem);
+    freeDominators(cfg, dom);
+    freeLiveness(cfg, lv);
+    return ssa;
+}
+
+bool* findStrictVregs(const CFG* cfg) {
+    int vregNum = cfg->func->vregNum, pos, k, j;
+    Dominators* dom = computeDominators(cfg);
+    int* defNum = (int*)calloc(vregNum + 1, sizeof(int));
+    int* defBlock = (int*)malloc((vregNum + 1) * sizeof(int));
+    int* defIndex = (int*)malloc((vregNum + 1) * sizeof(int));
+    bool* strict = (bool*)malloc((vregNum + 1) * sizeof(bool));
+    for (pos = 0; pos < cfg->orderNum; pos++) {
+        int b = cfg->order[pos];
+        const BasicBlock* block = &cfg->blocks[b];
+        for (k = 0; k < block->instNum; k++) {
+            int d = instDef(&block->insts[k]);
+            if (d < 0) { continue; }
+            // an array counts as defined twice, to be never strict
+            defNum[d] += block->insts[k].tag == I_DEC ? 2 : 1;
+            defBlock[d] = b;
+            defIndex[d] = k;
+        }
+    }
+    for (k = 0; k < vregNum; k++) { strict[k] = defNum[k] == 1; }
+    // a phi reads its args at the end of the predecessors
+    for (pos = 0; pos < cfg->orderNum; pos++) {
+        int b = cfg->order[pos];
+        const BasicBlock* block = &cfg->blocks[b];
+        for (k = 0; k < block->instNum; k++) {
+            const Instruction* i = &block->insts[k];
+            int uses[3], n, v;
+            if (i->tag == I_PHI) {
+                const PhiArg* args = i->addrs[1].content.args;
+                for (j = 0; j < i->addrs[2].content.lit; j++) {
+                    if (args[j].value.tag != OP_VAR) { continue; }
+                    v = args[j].value.content.vreg;
+                    if (strict[v] && !dominates(dom, defBlock[v], args[j].pred)) { strict[v] = false; }
+                }
+                continue;
+            }
+            n = instUses(i, uses);
+            for (j = 0; j < n; j++) {
+                v = uses[j];
+                if (!strict[v]) { continue; }
+                if (defBlock[v] == b ? defIndex[v] >= k : !dominates(dom, defBlock[v], b)) { strict[v] = false; }
+            }
+        }
+    }
+    free(defNum);
+    free(defBlock);
+    free(defIndex);
+    freeDominators(cfg, dom);
+    return strict;
+}
+
+void prunePhis(CFG* cfg) {
+    int b, k, j, p;
+    for (b = 0; b < cfg->blockNum; b++) {
+        BasicBlock* block = &cfg->blocks[b];
+        int end = firstNonPhi(block);
+        for (k = 0; k < end; k++) {
+            Instruction* i = &block->insts[k];
+            if (i->tag != I_PHI) { continue; }
+            PhiArg* args = i->addrs[1].content.args;
+            int n = 0;
+            for (j = 0; j < i->addrs[2].content.lit; j++) {
+                bool isPred = false;
+                for (p = 0; p < block->predNum; p++) {
+                    if (block->preds[p] == args[j].pred && cfg->blocks[args[j].pred].rpo >= 0) { isPred = true; }
+                }
+                if (isPred) { args[n++] = args[j]; }
+            }
+            i->addrs[2].content.lit = n;
+        }
+    }
+}
+
+static bool sameValue(int dest, const Oprand* src) {
+    return src->tag == OP_VAR && src->content.vreg == dest;
+}
+
+/*
+ * the parallel copies `dests[i] := srcs[i]` as a sequence inserted at `pos`
+ * a copy is ready when its destination is not read by the pending ones,
+ * and when none is ready the rest are cycles, one of which is broken by a temporary
+ */
+static void sequentializeCopies(CFG* cfg, int b, int pos, const int* dests, Oprand* srcs, int n) {
+    bool* done = (bool*)calloc(n + 1, sizeof(bool));
+    int remaining = 0, i, j;
+    for (i = 0; i < n; i++) {
+        if (sameValue(dests[i], &srcs[i])) { done[i] = true; }
+        else { remaining++; }
+    }
+    while (remaining > 0) {
+        bool progress = false;
+        for (i = 0; i < n; i++) {
+            if (done[i]) { continue; }
+            bool read = false;
+            for (j = 0; j < n && !read; j++) {
+                read = !done[j] && j != i && sameValue(dests[i], &srcs[j]);
+            }
+            if (read) { continue; }
+            insertInst(&cfg->blocks[b], pos++, makeBinaryInst(I_COPY, makeVarOp(dests[i]), srcs[i]));
+            done[i] = true;
+            remaining--;
+            progress = true;
+        }
+        if (progress) { continue; }
+        for (i = 0; done[i]; i++);
+        int t = newFuncVreg(cfg->func);
+        insertInst(&cfg->blocks[b], pos++, makeBinaryInst(I_COPY, makeVarOp(t), makeVarOp(dests[i])));
+        for (j = 0; j < n; j++) {
+            if (!done[j] && sameValue(dests[i], &srcs[j])) { srcs[j] = makeVarOp(t); }
+        }
+    }
+    free(done);
+}
+
+// the copies of the phis of `b` for the edge from `pred`
+static int collectCopies(const BasicBlock* block, int pred, int* dests, Oprand* srcs) {
+    int end = firstNonPhi(block), n = 0, k, j;
+    for (k = 0; k < end; k++) {
+        const Instruction* i = &block->insts[k];
+        if (i->tag != I_PHI) { continue; }
+        const PhiArg* args = i->addrs[1].content.args;
+        for (j = 0; j < i->addrs[2].content.lit; j++) {
+            if (args[j].pred != pred) { continue; }
+            if (!sameValue(i->addrs[0].content.vreg, &args[j].value)) {
+                dests[n] = i->addrs[0].content.vreg;
+                srcs[n] = args[j].value;
+                n++;
+            }
+            break;
+        }
+    }
+    return n;
+}
+
+/*
+ * the copies go to the end of the predecessor when it has no other successor,
+ * or else to a new block on the edge, so no other path sees them
+ */
+void destructSSA(CFG* cfg, SSAForm* ssa) {
+    int blockNum = cfg->blockNum, b, k, p;
+    for (b = 0; b < blockNum; b++) {
+        if (cfg->blocks[b].rpo < 0 || firstNonPhi(&cfg->blocks[b]) == 0) { continue; }
+        int phiNum = firstNonPhi(&cfg->blocks[b]);
+        int* dests = (int*)malloc((phiNum + 1) * sizeof(int));
+        Oprand* srcs = (Oprand*)malloc((phiNum + 1) * sizeof(Oprand));
+        int predNum = cfg->blocks[b].predNum;
+        int* preds = (int*)malloc((predNum + 1) * sizeof(int));
+        for (p = 0; p < predNum; p++) { preds[p] = cfg->blocks[b].preds[p]; }
+
+        for (p = 0; p < predNum; p++) {
+            int pred = preds[p];
+            if (cfg->blocks[pred].rpo < 0) { continue; }
+            int n = collectCopies(&cfg->blocks[b], pred, dests, srcs);
+            if (n == 0) { continue; }
+            const BasicBlock* from = &cfg->blocks[pred];
+            const Instruction* last = from->instNum == 0 ? NULL : &from->insts[from->instNum - 1];
+            if (from->succNum == 1 && (last == NULL || !isCondGoto(last->tag))) {
+                int pos = last != NULL && last->tag == I_GOTO ? from->instNum - 1 : from->instNum;
+                sequentializeCopies(cfg, pred, pos, dests, srcs, n);
+                continue;
+            }
+            // a critical edge
+            int mid = splitEdge(cfg, pred, b);
+            sequentializeCopies(cfg, mid, 1, dests, srcs, n);
+        }
+        free(dests);
+        free(srcs);
+        free(preds);
+    }
+    // the phis are all translated
+    for (b = 0; b < cfg->blockNum; b++) {
+        BasicBlock* block = &cfg->blocks[b];
+        int kept = 0;
+        for (k = 0; k < block->instNum; k++) {
+            if (block->insts[k].tag != I_PHI) { block->insts[kept++] = block->insts[k]; }
+        }
+        block->instNum = kept;
+    }
+    connectBlocks(cfg);
+    coalesceCopies(cfg, ssa->origin, ssa->num);
+    free(ssa->origin);
+    free(ssa);
+}
@@ -0,0 +1,31 @@
+#ifndef SSA_H
+#define SSA_H
+
+#include"cfg.h"
+
+/*
+ * the SSA form of a function, on its CFG
+ * the phis are placed at the iterated dominance frontiers of the definitions, for the vregs live there,
+ * and the vregs are renamed on a walk of the dominator tree, the first definition keeping the old name
+ * the arrays defined by I_DEC are memory rather than values, and are left as they are
+ */
+typedef struct SSAForm {
+    int* origin;        // the vreg each one is a new name of, the vregs made after the renaming are their own
+    int num, cap;
+} SSAForm;
+
+SSAForm* buildSSA(CFG* cfg);
+// where the ordinary instructions of a block start, after its label & phis
+int firstNonPhi(const BasicBlock* b);
+/*
+ * whether each vreg has a single definition dominating all its reads, on the heap
+ * the others are read before any write on some path, or are arrays, and are left alone by the passes
+ */
+bool* findStrictVregs(const CFG* cfg);
+// drop the args of the phis coming from the blocks no longer their predecessors, after the edges change
+void prunePhis(CFG* cfg);
+// replace the phis with copies on the incoming edges, splitting the critical ones,
+// then coalesce the copies, and free `ssa`
+void destructSSA(CFG* cfg, SSAForm* ssa);
+
+#endif
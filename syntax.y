@@ -1,58 +1,55 @@
 %{
-#define YYSTYPE struct Node*
 #define YYERROR_VERBOSE 1
 #include <stdio.h>
-#include "lex.yy.c"
 #include <stdlib.h>
 #include <memory.h>
 #include <assert.h>
 #include <stdarg.h>
 #include "parser.h"
 
-int errorType = 0;
+int yylex(YYSTYPE* lvalp, YYLTYPE* llocp, void* scanner);
+int yyget_lineno(void* scanner);
+void yyerror(YYLTYPE* llocp, void* scanner, Compilation* c, const char* msg);
 
 #define CONS_TOKEN(consName, vtag, contentType, contentField) \
-  Token* consName(contentType i){\
-    NEW(Token, p)\
-    p->tag = vtag;\
-    p->content.contentField = i;\
-    return p;\
+  Token consName(contentType i){\
+    Token t;\
+    t.tag = vtag;\
+    t.content.contentField = i;\
+    return t;\
   } \
 
 CONS_TOKEN(makeIntLit, INT, int, intLit)
 CONS_TOKEN(makeFloatLit, FLOAT, float, floatLit)
-CONS_TOKEN(makeID, ID, char*, reprS)
+CONS_TOKEN(makeID, ID, Identifier, id)
 CONS_TOKEN(makeType, TYPE, enum PrimTypeTag, pType)
 CONS_TOKEN(makeRelOp, RELOP, enum RelOpTag, relOp)
-Token* makeToken(enum yytokentype tag) {
-  NEW(Token, p);
-  p->tag = tag;
-  return p;
-}
 
-Node* makeTokenNode(Token* token) {
+Node* makeTokenNode(Token token) {
   NEW(Node, p);
   p->tag = TOKEN;
   p->content.terminal = token;
   return p;
 }
 
-Node* makeNonterminalNode(int column, enum NodeTag tag, int childNum, ...) {
+Node* makeNonterminalNode(int column, enum NodeTag tag, enum ProdTag prod, int childNum, ...) {
   assert(tag != TOKEN);
-  NEW(Node, p);
+  // the children are stored right behind the node
+  Node* p = (Node*)arenaAlloc(currentArena, sizeof(Node) + childNum * sizeof(Node*));
   p->tag = tag;
   p->content.nonterminal.column = column;
+  p->content.nonterminal.prod = prod;
+  p->content.nonterminal.type = NULL;
 
   va_list valist;
   va_start(valist, childNum);
 
   p->content.nonterminal.childNum = childNum;
-  NEW_ARRAY(Node*, pa, childNum);
   int i;
   for(i = 0; i < childNum; i++) {
-    pa[i] = va_arg(valist, Node*);
+    p->child[i] = va_arg(valist, Node*);
   }
-  p->content.nonterminal.child = pa;
+  va_end(valist);
   return p;
 }
 
@@ -72,17 +69,12 @@ void printToken(Token* token, int indent) {
   switch (token->tag) {
   case INT: printf("INT: %d\n", token->content.intLit); break;
   case FLOAT: printf("FLOAT: %f\n", token->content.floatLit); break;
-  case ID: printf("ID: "); printf("%s\n", token->content.reprS); break;
+  case ID: printf("ID: "); printf("%s\n", token->content.id.name); break;
   case TYPE: 
     if(token->content.pType == T_INT) { printf("int\n"); }
     else { printf("float\n"); }
     break;
-  PRINT_TOKEN(SEMI)  PRINT_TOKEN(COMMA) PRINT_TOKEN(ASSIGNOP)  PRINT_TOKEN(RELOP) 
-  PRINT_TOKEN(PLUS)  PRINT_TOKEN(MINUS) PRINT_TOKEN(STAR)      PRINT_TOKEN(DIV)
-  PRINT_TOKEN(AND)   PRINT_TOKEN(OR)    PRINT_TOKEN(DOT)       PRINT_TOKEN(NOT)
-  PRINT_TOKEN(LP)    PRINT_TOKEN(RP)    PRINT_TOKEN(LB)        PRINT_TOKEN(RB)
-  PRINT_TOKEN(LC)    PRINT_TOKEN(RC)    PRINT_TOKEN(STRUCT)    PRINT_TOKEN(RETURN)
-  PRINT_TOKEN(IF)    PRINT_TOKEN(ELSE)  PRINT_TOKEN(WHILE)
+  PRINT_TOKEN(RELOP)
   default: assert(0);
   }
 }
@@ -103,15 +95,25 @@ void printNonterminal(Node* root, int indent) {
   }
   int i;
   for (i = 0; i < root->content.nonterminal.childNum; i++) {
-    if(root->content.nonterminal.child[i] != NULL) {
-      printParseTree(root->content.nonterminal.child[i], indent + 1);
+    if(root->child[i] != NULL) {
+      printParseTree(root->child[i], indent + 1);
     }
   }
 }
 
+int countNodes(Node* root) {
+  if (root == NULL) { return 0; }
+  if (root->tag == TOKEN) { return 1; }
+  int i, n = 1;
+  for (i = 0; i < root->content.nonterminal.childNum; i++) {
+    n += countNodes(root->child[i]);
+  }
+  return n;
+}
+
 void printParseTree(Node* root, int indent) {
   if (root->tag == TOKEN) {
-    printToken(root->content.terminal, indent);
+    printToken(&root->content.terminal, indent);
   }
   else {
     printNonterminal(root, indent);
@@ -139,68 +141,74 @@ void printParseTree(Node* root, int indent) {
 %nonassoc LOWER_THAN_ELSE
 %nonassoc ELSE
 
-%parse-param {struct Node **root}
+/* a pure parser, the scanner and the compilation are passed around instead of kept in globals */
+%code requires { struct Compilation; }
+%define api.pure full
+%define api.value.type {struct Node*}
+%locations
+%param {void* scanner}
+%parse-param {struct Compilation* c}
 
 %%
-Show : Program { if(errorType == 0) { *root = $1; } }
+Show : Program { if(c->errorType == 0) { c->root = $1; } }
 
 /* High-level Definitions */
-Program : ExtDefList { $$ = makeNonterminalNode(@1.first_line, Program, 1, $1); }
+Program : ExtDefList { $$ = makeNonterminalNode(@1.first_line, Program, P_PROGRAM, 1, $1); }
   ;
 ExtDefList : /* empty */ { $$ = NULL; }
-  | ExtDef ExtDefList { $$ = makeNonterminalNode(@1.first_line, ExtDefList, 2, $1, $2); }
+  | ExtDef ExtDefList { $$ = makeNonterminalNode(@1.first_line, ExtDefList, P_EXT_DEF_LIST, 2, $1, $2); }
   ;
-ExtDef : Specifier ExtDecList SEMI { $$ = makeNonterminalNode(@1.first_line, ExtDef, 3, $1, $2, $3); }
-  | Specifier SEMI { $$ = makeNonterminalNode(@1.first_line, ExtDef, 2, $1, $2); }
-  | Specifier FunDec CompSt { $$ = makeNonterminalNode(@1.first_line, ExtDef, 3, $1, $2, $3); }
-  | Specifier FunDec SEMI { $$ = makeNonterminalNode(@1.first_line, ExtDef, 3, $1, $2, $3); }
+ExtDef : Specifier ExtDecList SEMI { $$ = makeNonterminalNode(@1.first_line, ExtDef, P_EXT_DEF_VAR, 2, $1, $2); }
+  | Specifier SEMI { $$ = makeNonterminalNode(@1.first_line, ExtDef, P_EXT_DEF_TYPE, 1, $1); }
+  | Specifier FunDec CompSt { $$ = makeNonterminalNode(@1.first_line, ExtDef, P_EXT_DEF_FUNC, 3, $1, $2, $3); }
+  | Specifier FunDec SEMI { $$ = makeNonterminalNode(@1.first_line, ExtDef, P_EXT_DEF_DECL, 2, $1, $2); }
   | Specifier error
   ;
-ExtDecList : VarDec { $$ = makeNonterminalNode(@1.first_line, ExtDecList, 1, $1); }
-  | VarDec COMMA ExtDecList { $$ = makeNonterminalNode(@1.first_line, ExtDecList, 3, $1, $2, $3); }
+ExtDecList : VarDec { $$ = makeNonterminalNode(@1.first_line, ExtDecList, P_EXT_DEC_LIST, 1, $1); }
+  | VarDec COMMA ExtDecList { $$ = makeNonterminalNode(@1.first_line, ExtDecList, P_EXT_DEC_LIST_CONS, 2, $1, $3); }
   ;
 
 /* Specifiers */
-Specifier : TYPE { $$ = makeNonterminalNode(@1.first_line, Specifier, 1, $1); }
-  | StructSpecifier { $$ = makeNonterminalNode(@1.first_line, Specifier, 1, $1); }
+Specifier : TYPE { $$ = makeNonterminalNode(@1.first_line, Specifier, P_SPECIFIER_TYPE, 1, $1); }
+  | StructSpecifier { $$ = makeNonterminalNode(@1.first_line, Specifier, P_SPECIFIER_STRUCT, 1, $1); }
   ;
-StructSpecifier : STRUCT OptTag LC DefList RC { $$ = makeNonterminalNode(@1.first_line, StructSpecifier, 5, $1, $2, $3, $4, $5); }
-  | STRUCT Tag { $$ = makeNonterminalNode(@1.first_line, StructSpecifier, 2, $1, $2); } 
+StructSpecifier : STRUCT OptTag LC DefList RC { $$ = makeNonterminalNode(@1.first_line, StructSpecifier, P_STRUCT_DEF, 2, $2, $4); }
+  | STRUCT Tag { $$ = makeNonterminalNode(@1.first_line, StructSpecifier, P_STRUCT_TAG, 1, $2); } 
   | STRUCT error LC DefList RC
   ;
 OptTag : /* empty */ { $$ = NULL; }
-  | ID { $$ = makeNonterminalNode(@1.first_line, OptTag, 1, $1); }
+  | ID { $$ = makeNonterminalNode(@1.first_line, OptTag, P_OPT_TAG, 1, $1); }
   ;
-Tag : ID { $$ = makeNonterminalNode(@1.first_line, Tag, 1, $1); }
+Tag : ID { $$ = makeNonterminalNode(@1.first_line, Tag, P_TAG, 1, $1); }
   ;
 
 /* Declarators */
-VarDec : ID { $$ = makeNonterminalNode(@1.first_line, VarDec, 1, $1); }
-  | VarDec LB INT RB { $$ = makeNonterminalNode(@1.first_line, VarDec, 4, $1, $2, $3, $4); }
+VarDec : ID { $$ = makeNonterminalNode(@1.first_line, VarDec, P_VAR_DEC_ID, 1, $1); }
+  | VarDec LB INT RB { $$ = makeNonterminalNode(@1.first_line, VarDec, P_VAR_DEC_ARRAY, 2, $1, $3); }
   | VarDec LB error Exp RB
   ;
-FunDec : ID LP VarList RP { $$ = makeNonterminalNode(@1.first_line, FunDec, 4, $1, $2, $3, $4); }
-  | ID LP RP { $$ = makeNonterminalNode(@1.first_line, FunDec, 3, $1, $2, $3); }
+FunDec : ID LP VarList RP { $$ = makeNonterminalNode(@1.first_line, FunDec, P_FUN_DEC_PARAMS, 2, $1, $3); }
+  | ID LP RP { $$ = makeNonterminalNode(@1.first_line, FunDec, P_FUN_DEC_EMPTY, 1, $1); }
   ;
-VarList : ParamDec COMMA VarList { $$ = makeNonterminalNode(@1.first_line, VarList, 3, $1, $2, $3); }
-  | ParamDec { $$ = makeNonterminalNode(@1.first_line, VarList, 1, $1); }
+VarList : ParamDec COMMA VarList { $$ = makeNonterminalNode(@1.first_line, VarList, P_VAR_LIST_CONS, 2, $1, $3); }
+  | ParamDec { $$ = makeNonterminalNode(@1.first_line, VarList, P_VAR_LIST, 1, $1); }
   ;
-ParamDec : Specifier VarDec { $$ = makeNonterminalNode(@1.first_line, ParamDec, 2, $1, $2); }
+ParamDec : Specifier VarDec { $$ = makeNonterminalNode(@1.first_line, ParamDec, P_PARAM_DEC, 2, $1, $2); }
   ;
 
 /* Statements */
-CompSt : LC DefList StmtList RC { $$ = makeNonterminalNode(@1.first_line, CompSt, 4, $1, $2, $3, $4); }
+CompSt : LC DefList StmtList RC { $$ = makeNonterminalNode(@1.first_line, CompSt, P_COMP_ST, 2, $2, $3); }
   | error RC
   ;
 StmtList : /* empty */ { $$ = NULL; }
-  | Stmt StmtList { $$ = makeNonterminalNode(@1.first_line, StmtList, 2, $1, $2); }
+  | Stmt StmtList { $$ = makeNonterminalNode(@1.first_line, StmtList, P_STMT_LIST, 2, $1, $2); }
   ;
-Stmt : Exp SEMI { $$ = makeNonterminalNode(@1.first_line, Stmt, 2, $1, $2); }
-  | CompSt { $$ = makeNonterminalNode(@1.first_line, Stmt, 1, $1); }
-  | RETURN Exp SEMI { $$ = makeNonterminalNode(@1.first_line, Stmt, 3, $1, $2, $3); }
-  | IF LP Exp RP Stmt %prec LOWER_THAN_ELSE { $$ = makeNonterminalNode(@1.first_line, Stmt, 5, $1, $2, $3, $4, $5); }
-  | IF LP Exp RP Stmt ELSE Stmt { $$ = makeNonterminalNode(@1.first_line, Stmt, 7, $1, $2, $3, $4, $5, $6, $7); }
-  | WHILE LP Exp RP Stmt { $$ = makeNonterminalNode(@1.first_line, Stmt, 5, $1, $2, $3, $4, $5); }
+Stmt : Exp SEMI { $$ = makeNonterminalNode(@1.first_line, Stmt, P_STMT_EXP, 1, $1); }
+  | CompSt { $$ = makeNonterminalNode(@1.first_line, Stmt, P_STMT_COMP_ST, 1, $1); }
+  | RETURN Exp SEMI { $$ = makeNonterminalNode(@1.first_line, Stmt, P_STMT_RETURN, 1, $2); }
+  | IF LP Exp RP Stmt %prec LOWER_THAN_ELSE { $$ = makeNonterminalNode(@1.first_line, Stmt, P_STMT_IF, 2, $3, $5); }
+  | IF LP Exp RP Stmt ELSE Stmt { $$ = makeNonterminalNode(@1.first_line, Stmt, P_STMT_IF_ELSE, 3, $3, $5, $7); }
+  | WHILE LP Exp RP Stmt { $$ = makeNonterminalNode(@1.first_line, Stmt, P_STMT_WHILE, 2, $3, $5); }
   | Specifier error SEMI
   | Exp error
   | error SEMI
@@ -213,52 +221,52 @@ Stmt : Exp SEMI { $$ = makeNonterminalNode(@1.first_line, Stmt, 2, $1, $2); }
 
 /* Local Definitions */
 DefList : /* empty */ { $$ = NULL; }
-  | Def DefList { $$ = makeNonterminalNode(@1.first_line, DefList, 2, $1, $2); }
+  | Def DefList { $$ = makeNonterminalNode(@1.first_line, DefList, P_DEF_LIST, 2, $1, $2); }
   ;
-Def : Specifier DecList SEMI { $$ = makeNonterminalNode(@1.first_line, Def, 3, $1, $2, $3); }
+Def : Specifier DecList SEMI { $$ = makeNonterminalNode(@1.first_line, Def, P_DEF, 2, $1, $2); }
   | error SEMI
   ;
-DecList : Dec { $$ = makeNonterminalNode(@1.first_line, DecList, 1, $1); } 
-  | Dec COMMA DecList { $$ = makeNonterminalNode(@1.first_line, DecList, 3, $1, $2, $3); }
+DecList : Dec { $$ = makeNonterminalNode(@1.first_line, DecList, P_DEC_LIST, 1, $1); } 
+  | Dec COMMA DecList { $$ = makeNonterminalNode(@1.first_line, DecList, P_DEC_LIST_CONS, 2, $1, $3); }
   ;
-Dec : VarDec { $$ = makeNonterminalNode(@1.first_line, Dec, 1, $1); }
-  | VarDec ASSIGNOP Exp { $$ = makeNonterminalNode(@1.first_line, Dec, 3, $1, $2, $3); }
+Dec : VarDec { $$ = makeNonterminalNode(@1.first_line, Dec, P_DEC_VAR, 1, $1); }
+  | VarDec ASSIGNOP Exp { $$ = makeNonterminalNode(@1.first_line, Dec, P_DEC_INIT, 2, $1, $3); }
   | VarDec ASSIGNOP error
   ;
 
 /* Expressions */
-Exp : Exp ASSIGNOP Exp { $$ = makeNonterminalNode(@1.first_line, Exp, 3, $1, $2, $3); }
-  | Exp AND Exp { $$ = makeNonterminalNode(@1.first_line, Exp, 3, $1, $2, $3); }
-  | Exp OR Exp { $$ = makeNonterminalNode(@1.first_line, Exp, 3, $1, $2, $3); }
-  | Exp RELOP Exp { $$ = makeNonterminalNode(@1.first_line, Exp, 3, $1, $2, $3); }
-  | Exp PLUS Exp { $$ = makeNonterminalNode(@1.first_line, Exp, 3, $1, $2, $3); }
-  | Exp MINUS Exp { $$ = makeNonterminalNode(@1.first_line, Exp, 3, $1, $2, $3); }
-  | Exp STAR Exp { $$ = makeNonterminalNode(@1.first_line, Exp, 3, $1, $2, $3); }
-  | Exp DIV Exp { $$ = makeNonterminalNode(@1.first_line, Exp, 3, $1, $2, $3); }
-  | LP Exp RP { $$ = makeNonterminalNode(@1.first_line, Exp, 3, $1, $2, $3); }
-  | MINUS Exp %prec STAR { $$ = makeNonterminalNode(@1.first_line, Exp, 2, $1, $2); }
-  | NOT Exp %prec STAR { $$ = makeNonterminalNode(@1.first_line, Exp, 2, $1, $2); }
-  | ID LP Args RP { $$ = makeNonterminalNode(@1.first_line, Exp, 4, $1, $2, $3, $4); }
-  | ID LP RP { $$ = makeNonterminalNode(@1.first_line, Exp, 3, $1, $2, $3); }
-  | Exp LB Exp RB { $$ = makeNonterminalNode(@1.first_line, Exp, 4, $1, $2, $3, $4); }
-  | Exp DOT ID { $$ = makeNonterminalNode(@1.first_line, Exp, 3, $1, $2, $3); }
-  | ID { $$ = makeNonterminalNode(@1.first_line, Exp, 1, $1); }
-  | INT { $$ = makeNonterminalNode(@1.first_line, Exp, 1, $1); }
-  | FLOAT { $$ = makeNonterminalNode(@1.first_line, Exp, 1, $1); }
+Exp : Exp ASSIGNOP Exp { $$ = makeNonterminalNode(@1.first_line, Exp, P_EXP_ASSIGN, 2, $1, $3); }
+  | Exp AND Exp { $$ = makeNonterminalNode(@1.first_line, Exp, P_EXP_AND, 2, $1, $3); }
+  | Exp OR Exp { $$ = makeNonterminalNode(@1.first_line, Exp, P_EXP_OR, 2, $1, $3); }
+  | Exp RELOP Exp { $$ = makeNonterminalNode(@1.first_line, Exp, P_EXP_RELOP, 3, $1, $3, $2); }
+  | Exp PLUS Exp { $$ = makeNonterminalNode(@1.first_line, Exp, P_EXP_PLUS, 2, $1, $3); }
+  | Exp MINUS Exp { $$ = makeNonterminalNode(@1.first_line, Exp, P_EXP_MINUS, 2, $1, $3); }
+  | Exp STAR Exp { $$ = makeNonterminalNode(@1.first_line, Exp, P_EXP_STAR, 2, $1, $3); }
+  | Exp DIV Exp { $$ = makeNonterminalNode(@1.first_line, Exp, P_EXP_DIV, 2, $1, $3); }
+  | LP Exp RP { $$ = makeNonterminalNode(@1.first_line, Exp, P_EXP_PAREN, 1, $2); }
+  | MINUS Exp %prec STAR { $$ = makeNonterminalNode(@1.first_line, Exp, P_EXP_NEG, 1, $2); }
+  | NOT Exp %prec STAR { $$ = makeNonterminalNode(@1.first_line, Exp, P_EXP_NOT, 1, $2); }
+  | ID LP Args RP { $$ = makeNonterminalNode(@1.first_line, Exp, P_EXP_CALL, 2, $1, $3); }
+  | ID LP RP { $$ = makeNonterminalNode(@1.first_line, Exp, P_EXP_CALL_EMPTY, 1, $1); }
+  | Exp LB Exp RB { $$ = makeNonterminalNode(@1.first_line, Exp, P_EXP_INDEX, 2, $1, $3); }
+  | Exp DOT ID { $$ = makeNonterminalNode(@1.first_line, Exp, P_EXP_FIELD, 2, $1, $3); }
+  | ID { $$ = makeNonterminalNode(@1.first_line, Exp, P_EXP_ID, 1, $1); }
+  | INT { $$ = makeNonterminalNode(@1.first_line, Exp, P_EXP_INT, 1, $1); }
+  | FLOAT { $$ = makeNonterminalNode(@1.first_line, Exp, P_EXP_FLOAT, 1, $1); }
   | Exp LB error RB
   | error RP
   | error Exp
   ;
-Args : Exp COMMA Args { $$ = makeNonterminalNode(@1.first_line, Args, 3, $1, $2, $3); }
-  | Exp { $$ = makeNonterminalNode(@1.first_line, Args, 1, $1); }
+Args : Exp COMMA Args { $$ = makeNonterminalNode(@1.first_line, Args, P_ARGS_CONS, 2, $1, $3); }
+  | Exp { $$ = makeNonterminalNode(@1.first_line, Args, P_ARGS, 1, $1); }
   ;
 
 %%
-yyerror(Node* _, char* msg) {
-  if(errorType != 1) {  // ignore type A error here
-    printf("Error Type B at Line %d\n", yylineno);
-    // printf("Error type B at Line %d:%s\n", yylineno, msg);
+void yyerror(YYLTYPE* llocp, void* scanner, Compilation* c, const char* msg) {
+  if(c->errorType != 1) {  // ignore type A error here
+    printf("Error Type B at Line %d\n", yyget_lineno(scanner));
+    // printf("Error type B at Line %d:%s\n", yyget_lineno(scanner), msg);
     // fprintf(stderr, "error: %s\n", msg);
   } 
-  errorType = 2;
+  c->errorType = 2;
 }
\ No newline at end of file
@@ -1,6 +1,59 @@
 #!/bin/bash
 
+# all the tests are compiled in a single process
+list=$(mktemp)
 for (( i=1; i<=19; i++))
 do
-  ./parser "tests/"$i".cmm"
+  echo "tests/"$i".cmm /dev/null" >> $list
 done
+./parser --batch=$list
+rm -f $list
+fail=0
+
+# the unit tests of the passes, on functions built by hand
+for unit in tests/*_test.c
+do
+  if ! make -s ${unit%.c} || ! ./${unit%.c}
+  then
+    echo "$unit failed"
+    fail=1
+  fi
+done
+
+# a source larger than one page read through a pipe compiles the same as from its path
+byPath=$(mktemp)
+byPipe=$(mktemp)
+./parser tests/large.cmm $byPath
+if ! cat tests/large.cmm | ./parser /dev/stdin $byPipe || ! cmp -s $byPath $byPipe
+then
+  echo "tests/large.cmm: wrong output through a pipe"
+  fail=1
+fi
+rm -f $byPath $byPipe
+
+# the programs with an expected output are run on SPIM, built both with the optimizations and `-O0`,
+# and each build must print the output
+# without SPIM they are skipped, and the script exits with 77, the status automake gives a skipped test, instead of 0
+spim=${SPIM:-spim}
+if ! command -v $spim > /dev/null
+then
+  echo "SKIPPED: $spim not found, the programs with an expected output are not run"
+  [ $fail == 0 ] && exit 77
+  exit $fail
+fi
+asm=$(mktemp)
+for expected in tests/*.out
+do
+  src=${expected%.out}.cmm
+  for flags in "" "-O0"
+  do
+    ./parser $src $asm $flags
+    if ! $spim -quiet -file $asm | diff -q - $expected > /dev/null
+    then
+      echo "$src $flags: wrong output"
+      fail=1
+    fi
+  done
+done
+rm -f $asm
+exit $fail
@@ -0,0 +1,163 @@
+#include "../dataflow.h"
+#include<stdio.h>
+#include<stdlib.h>
+
+/*
+ * the analyses on two small functions built by hand, a diamond & a loop
+ * the blocks are numbered in the order `buildCFG` splits them
+ */
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        printf("dataflow_test: %s\n", what);
+        failures++;
+    }
+}
+
+static Oprand v(int vreg) { return makeVarOp(vreg); }
+static Oprand lit(int x) { return makeLitOp(x); }
+static Oprand label(int l) { return makeLabelOp(l); }
+
+static IRFunction* makeFunc(const char* name, const Instruction* insts, int instNum, int vregNum, int labelNum) {
+    IRFunction* func = (IRFunction*)arenaAlloc(currentArena, sizeof(IRFunction));
+    func->insts = (Instruction*)arenaAlloc(currentArena, instNum * sizeof(Instruction));
+    int k;
+    for (k = 0; k < instNum; k++) { func->insts[k] = insts[k]; }
+    func->instNum = func->instCap = instNum;
+    func->name = intern(name);
+    func->localNum = 0;
+    func->localNames = NULL;
+    func->vregNum = vregNum;
+    func->labelNum = labelNum;
+    func->labelBase = 0;
+    return func;
+}
+
+// whether a definition of `vreg` in the block `from` reaches the start of `block`
+static bool reaches(const ReachingDefs* rd, int block, int vreg, int from) {
+    int k;
+    for (k = 0; k < rd->defNum; k++) {
+        if (rd->defVreg[k] == vreg && rd->defBlock[k] == from && bitTest(rd->df->in[block], k)) { return true; }
+    }
+    return false;
+}
+
+static bool availableAt(const AvailableExprs* ae, int block, Instruction i) {
+    int e = findExpr(ae, &i);
+    return e >= 0 && bitTest(ae->df->in[block], e);
+}
+
+/*
+ *  B0: v0 := #1; IF v0 == #0 GOTO L0
+ *  B1: v1 := v0 + #1; v2 := v0 * #2; GOTO L1
+ *  B2: LABEL L0; v1 := #5; v2 := v0 * #2
+ *  B3: LABEL L1; v3 := v1 + v2; RETURN v3
+ */
+static void testDiamond() {
+    Instruction insts[] = {
+        makeUnaryInst(I_FUNC, makeFuncOp(intern("diamond"))),
+        makeBinaryInst(I_ASSGN, v(0), lit(1)),
+        makeTernaryInst(I_EQGOTO, v(0), lit(0), label(0)),
+        makeTernaryInst(I_ADD, v(1), v(0), lit(1)),
+        makeTernaryInst(I_MUL, v(2), v(0), lit(2)),
+        makeUnaryInst(I_GOTO, label(1)),
+        makeUnaryInst(I_LABEL, label(0)),
+        makeBinaryInst(I_ASSGN, v(1), lit(5)),
+        makeTernaryInst(I_MUL, v(2), lit(2), v(0)),
+        makeUnaryInst(I_LABEL, label(1)),
+        makeTernaryInst(I_ADD, v(3), v(1), v(2)),
+        makeUnaryInst(I_RET, v(3)),
+    };
+    CFG* cfg = buildCFG(makeFunc("diamond", insts, sizeof(insts) / sizeof(insts[0]), 4, 2));
+    check(cfg->blockNum == 4, "diamond: 4 blocks");
+    Word* live = newBitset(BITSET_WORDS(4));
+
+    Liveness* lv = analyzeLiveness(cfg);
+    liveOut(lv, 0, live);
+    check(bitTest(live, 0) && !bitTest(live, 1) && !bitTest(live, 2), "diamond: only v0 live out of B0");
+    liveOut(lv, 1, live);
+    check(!bitTest(live, 0) && bitTest(live, 1) && bitTest(live, 2), "diamond: v1 & v2 live out of B1");
+    liveStep(live, &insts[4]);
+    check(bitTest(live, 0) && bitTest(live, 1) && !bitTest(live, 2), "diamond: v0 & v1 live before v2 := v0 * #2");
+    liveOut(lv, 3, live);
+    check(!bitTest(live, 0) && !bitTest(live, 1) && !bitTest(live, 2) && !bitTest(live, 3), "diamond: nothing live out of B3");
+    freeLiveness(cfg, lv);
+
+    ReachingDefs* rd = analyzeReachingDefs(cfg);
+    check(reaches(rd, 3, 1, 1) && reaches(rd, 3, 1, 2), "diamond: both v1 reach B3");
+    check(reaches(rd, 3, 0, 0), "diamond: v0 of B0 reaches B3");
+    check(!reaches(rd, 2, 1, 1), "diamond: v1 of B1 does not reach B2");
+    freeReachingDefs(cfg, rd);
+
+    AvailableExprs* ae = analyzeAvailableExprs(cfg);
+    check(availableAt(ae, 3, insts[4]), "diamond: v0 * #2 of both ways available in B3");
+    check(!availableAt(ae, 3, insts[3]), "diamond: v0 + #1 of one way not available in B3");
+    check(!availableAt(ae, 1, insts[4]), "diamond: v0 * #2 not available before it is computed");
+    freeAvailableExprs(cfg, ae);
+    free(live);
+}
+
+/*
+ *  B0: PARAM v4; v0 := #0; v1 := #0; v3 := v4 * #4
+ *  B1: LABEL L0; IF v0 >= #10 GOTO L1
+ *  B2: v1 := v1 + v0; v1 := v1 + v4; v0 := v0 + #1; GOTO L0
+ *  B3: LABEL L1; RETURN v1
+ */
+static void testLoop() {
+    Instruction insts[] = {
+        makeUnaryInst(I_FUNC, makeFuncOp(intern("loop"))),
+        makeUnaryInst(I_PARAM, v(4)),
+        makeBinaryInst(I_ASSGN, v(0), lit(0)),
+        makeBinaryInst(I_ASSGN, v(1), lit(0)),
+        makeTernaryInst(I_MUL, v(3), v(4), lit(4)),
+        makeUnaryInst(I_LABEL, label(0)),
+        makeTernaryInst(I_GEGOTO, v(0), lit(10), label(1)),
+        makeTernaryInst(I_ADD, v(1), v(1), v(0)),
+        makeTernaryInst(I_ADD, v(1), v(1), v(4)),
+        makeTernaryInst(I_ADD, v(0), v(0), lit(1)),
+        makeUnaryInst(I_GOTO, label(0)),
+        makeUnaryInst(I_LABEL, label(1)),
+        makeUnaryInst(I_RET, v(1)),
+    };
+    CFG* cfg = buildCFG(makeFunc("loop", insts, sizeof(insts) / sizeof(insts[0]), 5, 2));
+    check(cfg->blockNum == 4, "loop: 4 blocks");
+    Word* live = newBitset(BITSET_WORDS(5));
+
+    Liveness* lv = analyzeLiveness(cfg);
+    liveOut(lv, 2, live);
+    check(bitTest(live, 0) && bitTest(live, 1) && bitTest(live, 4), "loop: v0, v1 & v4 live around the back edge");
+    liveOut(lv, 1, live);
+    check(bitTest(live, 0) && bitTest(live, 1) && bitTest(live, 4), "loop: v0, v1 & v4 live out of the header");
+    check(!bitTest(live, 3), "loop: v3 never read");
+    freeLiveness(cfg, lv);
+
+    ReachingDefs* rd = analyzeReachingDefs(cfg);
+    check(reaches(rd, 1, 0, 0) && reaches(rd, 1, 0, 2), "loop: v0 reaches the header from B0 & the back edge");
+    check(reaches(rd, 3, 1, 0) && reaches(rd, 3, 1, 2), "loop: v1 reaches the exit from B0 & B2");
+    int k, reaching = 0;
+    for (k = 0; k < rd->defNum; k++) {
+        if (rd->defVreg[k] == 1 && rd->defBlock[k] == 2 && bitTest(rd->df->in[3], k)) { reaching++; }
+    }
+    check(reaching == 1, "loop: only the last v1 of B2 reaches the exit");
+    freeReachingDefs(cfg, rd);
+
+    AvailableExprs* ae = analyzeAvailableExprs(cfg);
+    check(availableAt(ae, 1, insts[4]) && availableAt(ae, 3, insts[4]), "loop: v4 * #4 available all over the loop");
+    check(!availableAt(ae, 1, insts[9]), "loop: v0 + #1 killed by its own write");
+    freeAvailableExprs(cfg, ae);
+    free(live);
+}
+
+int main() {
+    Arena arena = ARENA_INIT;
+    currentArena = &arena;
+    initAtoms();
+    testDiamond();
+    testLoop();
+    freeAtoms();
+    arenaFree(&arena);
+    currentArena = NULL;
+    if (failures == 0) { printf("dataflow_test: all passed\n"); }
+    return failures == 0 ? 0 : 1;
+}